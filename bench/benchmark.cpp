@@ -0,0 +1,900 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+//
+// storyofanerd_bench: microbenchmarks of the engine hot paths
+//
+// usage: storyofanerd_bench [--filter=<substring>] [--json=<results.json>]
+//                           [--baseline=<baseline.json>] [--threshold=<percent>]
+//
+// Every benchmark is calibrated to run at least MIN_RUN_SECONDS, the
+// reported time per operation is the median of up to REPETITIONS runs.
+// With --baseline the results are compared against a file written by
+// --json on the same machine, slowdowns above the threshold (default 10%)
+// are reported and make the exit code non-zero.
+//
+
+#include "common.h"
+#include "core.h"
+#include "graphics.h"
+#include "xmlloader.h"
+#include "clippedmap.h"
+#include "objecthandler.h"
+#include "../tools/mapgenerator.h"
+
+#include <SDL2/SDL.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::map;
+
+///////////////////////////////////////////////////////////////////////////
+
+static const double MIN_RUN_SECONDS = 0.1;
+static const uint REPETITIONS = 5;
+//! slow benchmarks (4096x4096 loads) stop repeating after this
+static const double MAX_BENCHMARK_SECONDS = 10.0;
+static const double DEFAULT_THRESHOLD_PERCENT = 10.0;
+
+static const int TILE_SIZE = MapGenerator::TILE_SIZE;
+
+//! directory of the generated maps, removed at exit
+static string work_directory;
+//! false if no offscreen renderer could be created
+static bool renderer_available = false;
+
+///////////////////////////////////////////////////////////////////////////
+
+class Benchmark
+{
+    public:
+        explicit Benchmark(const string &name) : m_name(name) {}
+        virtual ~Benchmark() {}
+
+        //! prepares everything that is not measured, false skips the benchmark
+        virtual bool setUp()
+        {
+            return true;
+        }
+
+        //! the measured part, runs the operation iterations times
+        virtual void run(uint64_t iterations) = 0;
+
+        virtual void tearDown() {}
+
+        inline const string& getName() const
+        {
+            return m_name;
+        }
+
+    private:
+        string m_name;
+
+        DISABLECOPY(Benchmark);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BenchmarkResult
+{
+    string      name;
+    double      ns_per_op;
+    uint64_t    iterations;
+    uint        repetitions;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! small deterministic generator, entity positions must not
+//! change between runs that are compared
+class BenchmarkRandom
+{
+    public:
+        explicit BenchmarkRandom(uint32_t seed) : m_state(seed) {}
+
+        inline uint32_t next(uint32_t range)
+        {
+            m_state = m_state * 1664525u + 1013904223u;
+            return (m_state >> 8) % range;
+        }
+
+    private:
+        uint32_t m_state;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! a tileset image with the layout of tmw_desert_spacing.png, the maps of
+//! the generator use it
+static bool writeTileSet(const string &filename)
+{
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0,
+        MapGenerator::TILESET_IMAGE_WIDTH, MapGenerator::TILESET_IMAGE_HEIGHT, 32,
+        SDL_PIXELFORMAT_RGBA8888);
+    if(surface == NULL)
+    {
+        return false;
+    }
+
+    //one flat color per tile is enough to tell them apart
+    static const int STRIDE = MapGenerator::TILE_SIZE + MapGenerator::TILESET_SPACING;
+    for(uint row = 0; row < MapGenerator::TILESET_ROWS; row++)
+    {
+        for(uint column = 0; column < MapGenerator::TILESET_COLUMNS; column++)
+        {
+            SDL_Rect tile = {static_cast<int>(MapGenerator::TILESET_MARGIN + column * STRIDE),
+                             static_cast<int>(MapGenerator::TILESET_MARGIN + row * STRIDE),
+                             TILE_SIZE, TILE_SIZE};
+            SDL_FillRect(surface, &tile, SDL_MapRGBA(surface->format,
+                         column * 32, row * 40, 128, 255));
+        }
+    }
+
+    bool saved = SDL_SaveBMP(surface, filename.c_str()) == 0;
+    SDL_FreeSurface(surface);
+    return saved;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! writes a map of storyofanerd_mapgen with its default terrain and
+//! object density and returns its filename ("" on failure), format is a
+//! layer encoding of the generator or "cmap" (compiled from the zlib map)
+static string createMap(uint width, uint height, const string &format)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/map_%ux%u_%s", width, height, format.c_str());
+    string tmx_filename = work_directory + name + ".tmx";
+
+    if(writeTileSet(work_directory + "/tileset.bmp") == false)
+    {
+        return "";
+    }
+
+    GeneratorOptions options;
+    options.width = width;
+    options.height = height;
+    options.encoding = format == "cmap" ? "zlib" : format;
+    options.seed = width * 31 + height;
+    options.image_source = "tileset.bmp";
+
+    MapGenerator generator(options);
+    if(generator.write(tmx_filename) != OK)
+    {
+        return "";
+    }
+
+    if(format != "cmap")
+    {
+        return tmx_filename;
+    }
+
+    string cmap_filename = work_directory + name + ".cmap";
+    LoadedMap lmap(tmx_filename);
+    bool compiled = lmap.loadFile() == OK &&
+                    lmap.saveBinaryFile(cmap_filename) == OK;
+    unlink(tmx_filename.c_str());
+
+    return compiled == true ? cmap_filename : "";
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static string sizeName(uint width, uint height)
+{
+    char size[32];
+    snprintf(size, sizeof(size), "%ux%u", width, height);
+    return size;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one LoadedMap::loadFile per operation
+class LoadMapBenchmark : public Benchmark
+{
+    public:
+        LoadMapBenchmark(uint width, uint height, const string &format) :
+            Benchmark("loadfile/" + format + "/" + sizeName(width, height)),
+            m_width(width), m_height(height), m_format(format)
+        {
+        }
+
+        virtual bool setUp()
+        {
+            m_filename = createMap(m_width, m_height, m_format);
+            return m_filename != "";
+        }
+
+        virtual void run(uint64_t iterations)
+        {
+            for(uint64_t i = 0; i < iterations; i++)
+            {
+                LoadedMap lmap(m_filename);
+                if(lmap.loadFile() != OK)
+                {
+                    fprintf(stderr, "%s: loading failed\n", m_filename.c_str());
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+
+        virtual void tearDown()
+        {
+            unlink(m_filename.c_str());
+        }
+
+    private:
+        uint m_width;
+        uint m_height;
+        string m_format;
+        string m_filename;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+enum ClippedMapMode
+{
+    //! tiles copied into one GraphicsObject each (copyTilesToRender)
+    CLIPPEDMAP_COPY_TILES,
+    //! camera mode, the viewport does not move (baked chunks are reused)
+    CLIPPEDMAP_STATIC,
+    //! camera mode, the viewport moves every frame
+    CLIPPEDMAP_SCROLLING
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one offscreen frame (clear, tile emission, present) per operation
+class ClippedMapBenchmark : public Benchmark
+{
+    public:
+        ClippedMapBenchmark(uint width, uint height, ClippedMapMode mode) :
+            Benchmark(string("clippedmap/") + modeName(mode) + "/" +
+                      sizeName(width, height)),
+            m_width(width), m_height(height), m_mode(mode),
+            m_map(NULL)
+        {
+        }
+
+        virtual bool setUp()
+        {
+            if(renderer_available == false)
+            {
+                return false;
+            }
+
+            m_filename = createMap(m_width, m_height, "zlib");
+            if(m_filename == "")
+            {
+                return false;
+            }
+
+            m_loaded_map.reset(new LoadedMap(m_filename));
+            if(m_loaded_map.get()->loadFile() != OK)
+            {
+                return false;
+            }
+
+            m_map = new ClippedMap(m_loaded_map.get());
+            if(m_mode == CLIPPEDMAP_COPY_TILES)
+            {
+                m_map->copyTilesToRender(0, 0);
+            }
+            else
+            {
+                m_map->setViewport(0, 0);
+            }
+            return true;
+        }
+
+        virtual void run(uint64_t iterations)
+        {
+            GraphicsCore &gcore = GraphicsCore::instance();
+
+            //wrap around halfway, well before the view leaves the map
+            int scroll_range = m_width * TILE_SIZE / 2;
+            if(scroll_range < 1)
+            {
+                scroll_range = 1;
+            }
+
+            for(uint64_t i = 0; i < iterations; i++)
+            {
+                if(m_mode == CLIPPEDMAP_SCROLLING)
+                {
+                    m_map->setViewport((i * 7) % scroll_range, 0);
+                }
+
+                gcore.clearRenderer();
+                m_map->drawAll(1.0f);
+                gcore.presentRenderer();
+            }
+        }
+
+        virtual void tearDown()
+        {
+            delete m_map;
+            m_map = NULL;
+            m_loaded_map.reset();
+            unlink(m_filename.c_str());
+        }
+
+    private:
+        static const char* modeName(ClippedMapMode mode)
+        {
+            switch(mode)
+            {
+                case CLIPPEDMAP_COPY_TILES:
+                    return "copytiles";
+                case CLIPPEDMAP_STATIC:
+                    return "static";
+                case CLIPPEDMAP_SCROLLING:
+                    return "scrolling";
+            }
+            return "";
+        }
+
+        uint m_width;
+        uint m_height;
+        ClippedMapMode m_mode;
+        string m_filename;
+
+        shared_ptr<LoadedMap> m_loaded_map;
+        ClippedMap *m_map;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+enum CollisionMode
+{
+    //! one Objecthandler::checkCollision
+    COLLISION_CHECK,
+    //! one entity moved along its own velocity, updates the broadphase
+    COLLISION_MOVE
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one collision operation per iteration, entity_count 32x32 objects
+//! spread over a 2048x2048 area
+class CollisionBenchmark : public Benchmark
+{
+    public:
+        CollisionBenchmark(uint entity_count, CollisionMode mode) :
+            Benchmark(string("collision/") + modeName(mode) + "/" +
+                      std::to_string(entity_count)),
+            m_entity_count(entity_count), m_mode(mode)
+        {
+        }
+
+        virtual bool setUp()
+        {
+            BenchmarkRandom random(m_entity_count);
+            for(uint i = 0; i < m_entity_count; i++)
+            {
+                shared_ptr<GameObject> entity(
+                    new GameObject("bench_entity_" + std::to_string(i)));
+                entity.get()->addGraphicsObject(shared_ptr<GraphicsObject>(
+                    new GraphicsObject(shared_ptr<SDL_Texture>(),
+                                       random.next(AREA_SIZE), random.next(AREA_SIZE),
+                                       TILE_SIZE, TILE_SIZE)));
+
+                Scene.addGameObject(entity);
+                m_entities.push_back(entity);
+
+                //-2 to 2 pixels per axis and step
+                m_velocities.push_back(static_cast<int>(random.next(5)) - 2);
+                m_velocities.push_back(static_cast<int>(random.next(5)) - 2);
+            }
+            return true;
+        }
+
+        virtual void run(uint64_t iterations)
+        {
+            Objecthandler &handler = Scene;
+
+            uint collisions = 0;
+            for(uint64_t i = 0; i < iterations; i++)
+            {
+                uint index = i % m_entity_count;
+                if(m_mode == COLLISION_MOVE)
+                {
+                    GraphicsObject *object =
+                        m_entities[index].get()->getGraphicsObjects().at(0).get();
+                    object->setX(wrap(object->getX() + m_velocities[index * 2]));
+                    object->setY(wrap(object->getY() + m_velocities[index * 2 + 1]));
+                }
+                else if(handler.checkCollision(*m_entities[index].get()) == true)
+                {
+                    collisions++;
+                }
+            }
+
+            //keeps the calls from being optimized away
+            m_collisions = collisions;
+        }
+
+        virtual void tearDown()
+        {
+            for(uint i = 0; i < m_entities.size(); i++)
+            {
+                Scene.removeGameObject(m_entities[i]);
+            }
+            m_entities.clear();
+            m_velocities.clear();
+        }
+
+    private:
+        static const int AREA_SIZE = 2048;
+
+        static int wrap(int position)
+        {
+            return (position + AREA_SIZE) % AREA_SIZE;
+        }
+
+        static const char* modeName(CollisionMode mode)
+        {
+            switch(mode)
+            {
+                case COLLISION_CHECK:
+                    return "checkcollision";
+                case COLLISION_MOVE:
+                    return "move";
+            }
+            return "";
+        }
+
+        uint m_entity_count;
+        CollisionMode m_mode;
+        vector<shared_ptr<GameObject> > m_entities;
+        vector<int> m_velocities;
+        volatile uint m_collisions;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+enum LoggerMode
+{
+    //! below the runtime level, only the isEnabled check runs
+    LOGGER_FILTERED,
+    LOGGER_SYNC,
+    LOGGER_ASYNC,
+    LOGGER_BINARY
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one LOGMESSAGE per operation through the global logger, stdout is
+//! redirected to /dev/null while measuring
+class LoggerBenchmark : public Benchmark
+{
+    public:
+        explicit LoggerBenchmark(LoggerMode mode) :
+            Benchmark(string("logger/") + modeName(mode)),
+            m_mode(mode), m_saved_stdout(-1)
+        {
+        }
+
+        virtual bool setUp()
+        {
+            int null_output = open("/dev/null", O_WRONLY);
+            if(null_output < 0)
+            {
+                return false;
+            }
+
+            fflush(stdout);
+            m_saved_stdout = dup(STDOUT_FILENO);
+            dup2(null_output, STDOUT_FILENO);
+            close(null_output);
+
+            Logger.setLogLevel(LOG_INFO);
+            if(m_mode == LOGGER_ASYNC)
+            {
+                //blocking, dropped messages would look like free ones
+                Logger.startAsync(ASYNC_QUEUE_SIZE, LOG_OVERFLOW_BLOCK);
+            }
+            else if(m_mode == LOGGER_BINARY)
+            {
+                return Logger.startBinary("/dev/null") == OK;
+            }
+            return true;
+        }
+
+        virtual void run(uint64_t iterations)
+        {
+            for(uint64_t i = 0; i < iterations; i++)
+            {
+                if(m_mode == LOGGER_FILTERED)
+                {
+                    LOGMESSAGE(LOG_DEBUG, LOG_APP, "bench: message %llu of %s\n",
+                               static_cast<unsigned long long>(i), "run");
+                }
+                else
+                {
+                    LOGMESSAGE(LOG_INFO, LOG_APP, "bench: message %llu of %s\n",
+                               static_cast<unsigned long long>(i), "run");
+                }
+            }
+        }
+
+        virtual void tearDown()
+        {
+            Logger.stopAsync();
+            Logger.stopBinary();
+            Logger.setLogLevel(LOG_WARNING);
+
+            if(m_saved_stdout >= 0)
+            {
+                fflush(stdout);
+                dup2(m_saved_stdout, STDOUT_FILENO);
+                close(m_saved_stdout);
+                m_saved_stdout = -1;
+            }
+        }
+
+    private:
+        static const char* modeName(LoggerMode mode)
+        {
+            switch(mode)
+            {
+                case LOGGER_FILTERED:
+                    return "filtered";
+                case LOGGER_SYNC:
+                    return "sync";
+                case LOGGER_ASYNC:
+                    return "async";
+                case LOGGER_BINARY:
+                    return "binary";
+            }
+            return "";
+        }
+
+        //! same as the logger default
+        static const size_t ASYNC_QUEUE_SIZE = 4096;
+
+        LoggerMode m_mode;
+        int m_saved_stdout;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+static double runTimed(Benchmark *benchmark, uint64_t iterations)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    benchmark->run(iterations);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static bool measure(Benchmark *benchmark, BenchmarkResult *result)
+{
+    if(benchmark->setUp() == false)
+    {
+        benchmark->tearDown();
+        return false;
+    }
+
+    //grow the iteration count until one run takes MIN_RUN_SECONDS
+    uint64_t iterations = 1;
+    double elapsed = runTimed(benchmark, iterations);
+    while(elapsed < MIN_RUN_SECONDS)
+    {
+        double factor = elapsed > 0.0 ? MIN_RUN_SECONDS * 1.4 / elapsed : 100.0;
+        factor = std::min(std::max(factor, 2.0), 100.0);
+        iterations = static_cast<uint64_t>(iterations * factor);
+        elapsed = runTimed(benchmark, iterations);
+    }
+
+    vector<double> samples;
+    samples.push_back(elapsed * 1e9 / iterations);
+    double total = elapsed;
+    while(samples.size() < REPETITIONS && total < MAX_BENCHMARK_SECONDS)
+    {
+        elapsed = runTimed(benchmark, iterations);
+        samples.push_back(elapsed * 1e9 / iterations);
+        total += elapsed;
+    }
+
+    benchmark->tearDown();
+
+    std::sort(samples.begin(), samples.end());
+    result->name = benchmark->getName();
+    result->ns_per_op = samples[samples.size() / 2];
+    result->iterations = iterations;
+    result->repetitions = samples.size();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static ErrorCode writeResults(const string &filename, const vector<BenchmarkResult> &results)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    //one benchmark per line, readBaseline relies on it
+    fprintf(file, "{\n  \"benchmarks\": [\n");
+    for(uint i = 0; i < results.size(); i++)
+    {
+        fprintf(file, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+                "\"iterations\": %llu, \"repetitions\": %u}%s\n",
+                results[i].name.c_str(), results[i].ns_per_op,
+                static_cast<unsigned long long>(results[i].iterations),
+                results[i].repetitions, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    if(fclose(file) != 0)
+    {
+        return ERROR_OPENING_FILE;
+    }
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! reads name -> ns_per_op of a file written by writeResults
+static ErrorCode readBaseline(const string &filename, map<string, double> *baseline)
+{
+    FILE *file = fopen(filename.c_str(), "r");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    static const char NAME_KEY[] = "\"name\": \"";
+    static const char TIME_KEY[] = "\"ns_per_op\": ";
+
+    char line[1024];
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        const char *name = strstr(line, NAME_KEY);
+        const char *time = strstr(line, TIME_KEY);
+        if(name == NULL || time == NULL)
+        {
+            continue;
+        }
+
+        name += sizeof(NAME_KEY) - 1;
+        const char *name_end = strchr(name, '"');
+        if(name_end == NULL)
+        {
+            continue;
+        }
+
+        (*baseline)[string(name, name_end)] = strtod(time + sizeof(TIME_KEY) - 1, NULL);
+    }
+
+    fclose(file);
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! prints the change of every benchmark, returns the number of regressions
+static uint compareResults(const vector<BenchmarkResult> &results,
+                           const map<string, double> &baseline, double threshold)
+{
+    uint regressions = 0;
+
+    printf("\n%-40s %14s %14s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+    for(uint i = 0; i < results.size(); i++)
+    {
+        map<string, double>::const_iterator it = baseline.find(results[i].name);
+        if(it == baseline.end() || it->second <= 0.0)
+        {
+            printf("%-40s %14s %14.1f %9s\n", results[i].name.c_str(), "-",
+                   results[i].ns_per_op, "new");
+            continue;
+        }
+
+        double change = (results[i].ns_per_op / it->second - 1.0) * 100.0;
+        bool regressed = change > threshold;
+        if(regressed == true)
+        {
+            regressions++;
+        }
+
+        printf("%-40s %14.1f %14.1f %+8.1f%%%s\n", results[i].name.c_str(),
+               it->second, results[i].ns_per_op, change,
+               regressed == true ? "  REGRESSION" : "");
+    }
+
+    return regressions;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static void removeWorkDirectory()
+{
+    string tileset = work_directory + "/tileset.bmp";
+    unlink(tileset.c_str());
+    rmdir(work_directory.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static void createBenchmarks(vector<shared_ptr<Benchmark> > *benchmarks)
+{
+    static const uint MAP_SIZES[][2] = {{32, 5}, {256, 256}, {1024, 1024}, {4096, 4096}};
+    static const char* const MAP_FORMATS[] = {"csv", "zlib", "gzip", "zstd", "cmap"};
+    static const uint ENTITY_COUNTS[] = {10, 100, 1000, 10000};
+
+    for(uint format = 0; format < sizeof(MAP_FORMATS) / sizeof(MAP_FORMATS[0]); format++)
+    {
+        if(MAP_FORMATS[format] != string("cmap") &&
+           MapGenerator::isSupportedEncoding(MAP_FORMATS[format]) == false)
+        {
+            continue;
+        }
+
+        for(uint size = 0; size < sizeof(MAP_SIZES) / sizeof(MAP_SIZES[0]); size++)
+        {
+            benchmarks->push_back(shared_ptr<Benchmark>(new LoadMapBenchmark(
+                MAP_SIZES[size][0], MAP_SIZES[size][1], MAP_FORMATS[format])));
+        }
+    }
+
+    //one GraphicsObject per tile, keep it small
+    benchmarks->push_back(shared_ptr<Benchmark>(
+        new ClippedMapBenchmark(64, 64, CLIPPEDMAP_COPY_TILES)));
+    benchmarks->push_back(shared_ptr<Benchmark>(
+        new ClippedMapBenchmark(256, 256, CLIPPEDMAP_STATIC)));
+    benchmarks->push_back(shared_ptr<Benchmark>(
+        new ClippedMapBenchmark(256, 256, CLIPPEDMAP_SCROLLING)));
+
+    for(uint i = 0; i < sizeof(ENTITY_COUNTS) / sizeof(ENTITY_COUNTS[0]); i++)
+    {
+        benchmarks->push_back(shared_ptr<Benchmark>(
+            new CollisionBenchmark(ENTITY_COUNTS[i], COLLISION_CHECK)));
+        benchmarks->push_back(shared_ptr<Benchmark>(
+            new CollisionBenchmark(ENTITY_COUNTS[i], COLLISION_MOVE)));
+    }
+
+    benchmarks->push_back(shared_ptr<Benchmark>(new LoggerBenchmark(LOGGER_FILTERED)));
+    benchmarks->push_back(shared_ptr<Benchmark>(new LoggerBenchmark(LOGGER_SYNC)));
+    benchmarks->push_back(shared_ptr<Benchmark>(new LoggerBenchmark(LOGGER_ASYNC)));
+    benchmarks->push_back(shared_ptr<Benchmark>(new LoggerBenchmark(LOGGER_BINARY)));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    string filter;
+    string json_filename;
+    string baseline_filename;
+    double threshold = DEFAULT_THRESHOLD_PERCENT;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strncmp(argv[i], "--filter=", 9) == 0)
+        {
+            filter = argv[i] + 9;
+        }
+        else if(strncmp(argv[i], "--json=", 7) == 0)
+        {
+            json_filename = argv[i] + 7;
+        }
+        else if(strncmp(argv[i], "--baseline=", 11) == 0)
+        {
+            baseline_filename = argv[i] + 11;
+        }
+        else if(strncmp(argv[i], "--threshold=", 12) == 0)
+        {
+            threshold = atof(argv[i] + 12);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter=<substring>] [--json=<results.json>] "
+                    "[--baseline=<baseline.json>] [--threshold=<percent>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    map<string, double> baseline;
+    if(baseline_filename != "" && readBaseline(baseline_filename, &baseline) != OK)
+    {
+        fprintf(stderr, "%s: could not read baseline\n", baseline_filename.c_str());
+        return EXIT_FAILURE;
+    }
+
+    GameCore::instance().logger().setLogLevel(LOG_WARNING);
+
+    //rendering benchmarks are skipped when no renderer can be created
+    GraphicsCore &gcore = GraphicsCore::instance();
+    renderer_available = gcore.initializeWindow(DISPLAY_OFFSCREEN) == OK &&
+                         gcore.initializeRenderer() == OK;
+    if(renderer_available == false)
+    {
+        fprintf(stderr, "no offscreen renderer, clippedmap benchmarks are skipped\n");
+    }
+
+    char directory[] = "/tmp/storyofanerd_bench.XXXXXX";
+    if(mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "could not create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+    work_directory = directory;
+
+    vector<shared_ptr<Benchmark> > benchmarks;
+    createBenchmarks(&benchmarks);
+
+    vector<BenchmarkResult> results;
+    for(uint i = 0; i < benchmarks.size(); i++)
+    {
+        Benchmark *benchmark = benchmarks[i].get();
+        if(filter != "" && benchmark->getName().find(filter) == string::npos)
+        {
+            continue;
+        }
+
+        BenchmarkResult result;
+        if(measure(benchmark, &result) == false)
+        {
+            printf("%-40s skipped\n", benchmark->getName().c_str());
+            continue;
+        }
+
+        printf("%-40s %14.1f ns/op %12llu iterations\n", result.name.c_str(),
+               result.ns_per_op, static_cast<unsigned long long>(result.iterations));
+        fflush(stdout);
+        results.push_back(result);
+    }
+
+    removeWorkDirectory();
+
+    if(json_filename != "" && writeResults(json_filename, results) != OK)
+    {
+        fprintf(stderr, "%s: could not write results\n", json_filename.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if(baseline_filename != "" && compareResults(results, baseline, threshold) > 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
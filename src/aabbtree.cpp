@@ -0,0 +1,661 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <string.h>
+
+#include "aabbtree.h"
+#include "graphicsobject.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline AABB combine(const AABB &a, const AABB &b)
+{
+    AABB box;
+    box.min_x = std::min(a.min_x, b.min_x);
+    box.min_y = std::min(a.min_y, b.min_y);
+    box.max_x = std::max(a.max_x, b.max_x);
+    box.max_y = std::max(a.max_y, b.max_y);
+    return box;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline int64_t perimeter(const AABB &box)
+{
+    return 2 * (static_cast<int64_t>(box.max_x - box.min_x) + (box.max_y - box.min_y));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline bool contains(const AABB &outer, const AABB &inner)
+{
+    return outer.min_x <= inner.min_x && outer.min_y <= inner.min_y &&
+           inner.max_x <= outer.max_x && inner.max_y <= outer.max_y;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline bool overlaps(const AABB &a, const AABB &b)
+{
+    return a.min_x < b.max_x && b.min_x < a.max_x &&
+           a.min_y < b.max_y && b.min_y < a.max_y;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! entry fraction of the segment p + t * d into box, false if it misses
+//! or enters after max_fraction
+static bool intersectSegment(const AABB &box, float x0, float y0, float dx, float dy,
+                             float max_fraction, float *fraction)
+{
+    float t_min = 0.0f;
+    float t_max = max_fraction;
+
+    const float origin[2] = {x0, y0};
+    const float direction[2] = {dx, dy};
+    const float box_min[2] = {static_cast<float>(box.min_x), static_cast<float>(box.min_y)};
+    const float box_max[2] = {static_cast<float>(box.max_x), static_cast<float>(box.max_y)};
+
+    for(uint axis = 0; axis < 2; axis++)
+    {
+        if(direction[axis] == 0.0f)
+        {
+            if(origin[axis] < box_min[axis] || origin[axis] >= box_max[axis])
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float t1 = (box_min[axis] - origin[axis]) / direction[axis];
+        float t2 = (box_max[axis] - origin[axis]) / direction[axis];
+        if(t1 > t2)
+        {
+            std::swap(t1, t2);
+        }
+
+        t_min = std::max(t_min, t1);
+        t_max = std::min(t_max, t2);
+        if(t_min > t_max)
+        {
+            return false;
+        }
+    }
+
+    *fraction = t_min;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+AABBTree::AABBTree() :
+    m_root(NULL_NODE),
+    m_free_list(NULL_NODE),
+    m_object_count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+AABBTree::~AABBTree()
+{
+    //objects may outlive the tree, make sure they do not point back to it
+    for(uint i = 0; i < m_nodes.size(); i++)
+    {
+        if(m_nodes[i].height == 0 && m_nodes[i].object != NULL)
+        {
+            m_nodes[i].object->getTreeProxy().tree = NULL;
+            m_nodes[i].object->getTreeProxy().node = NULL_NODE;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+AABB AABBTree::toAABB(const SDL_Rect &rect)
+{
+    AABB box;
+    box.min_x = rect.x;
+    box.min_y = rect.y;
+    box.max_x = rect.x + rect.w;
+    box.max_y = rect.y + rect.h;
+    return box;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int AABBTree::getStretch(int move)
+{
+    //capped, a teleport is not a velocity
+    static const int64_t MAX_STRETCH = 8 * AABB_MARGIN;
+    int64_t stretch = static_cast<int64_t>(move) * AABB_DISPLACEMENT_MULTIPLIER;
+    return static_cast<int>(std::max(-MAX_STRETCH, std::min(MAX_STRETCH, stretch)));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+AABB AABBTree::fatten(const AABB &box)
+{
+    AABB fat;
+    fat.min_x = box.min_x - AABB_MARGIN;
+    fat.min_y = box.min_y - AABB_MARGIN;
+    fat.max_x = box.max_x + AABB_MARGIN;
+    fat.max_y = box.max_y + AABB_MARGIN;
+    return fat;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int AABBTree::allocateNode()
+{
+    int node = m_free_list;
+    if(node == NULL_NODE)
+    {
+        node = m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+    else
+    {
+        m_free_list = m_nodes[node].parent;
+    }
+
+    Node &allocated = m_nodes[node];
+    allocated.object = NULL;
+    allocated.parent = NULL_NODE;
+    allocated.child_1 = NULL_NODE;
+    allocated.child_2 = NULL_NODE;
+    allocated.height = 0;
+    return node;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::freeNode(int node)
+{
+    m_nodes[node].object = NULL;
+    m_nodes[node].height = -1;
+    m_nodes[node].parent = m_free_list;
+    m_free_list = node;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::insert(GraphicsObject *obj)
+{
+    assert(obj);
+
+    AABBTreeProxy &proxy = obj->getTreeProxy();
+    if(proxy.tree == this)
+    {
+        update(obj);
+        return;
+    }
+    assert(proxy.tree == NULL);
+
+    AABB box = toAABB(*(obj->getDst().get()));
+    int leaf = allocateNode();
+    m_nodes[leaf].box = fatten(box);
+    m_nodes[leaf].object = obj;
+
+    insertLeaf(leaf);
+
+    proxy.tree = this;
+    proxy.node = leaf;
+    proxy.x = box.min_x;
+    proxy.y = box.min_y;
+    proxy.move_x = 0;
+    proxy.move_y = 0;
+    m_object_count++;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::remove(GraphicsObject *obj)
+{
+    assert(obj);
+
+    AABBTreeProxy &proxy = obj->getTreeProxy();
+    if(proxy.tree != this)
+    {
+        return;
+    }
+
+    removeLeaf(proxy.node);
+    freeNode(proxy.node);
+
+    proxy.tree = NULL;
+    proxy.node = NULL_NODE;
+    m_object_count--;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::update(GraphicsObject *obj)
+{
+    AABBTreeProxy &proxy = obj->getTreeProxy();
+    if(proxy.tree != this)
+    {
+        return;
+    }
+
+    //setX and setY arrive separately, each axis keeps the step of the
+    //last call that moved it
+    AABB box = toAABB(*(obj->getDst().get()));
+    if(box.min_x != proxy.x)
+    {
+        proxy.move_x = box.min_x - proxy.x;
+        proxy.x = box.min_x;
+    }
+    if(box.min_y != proxy.y)
+    {
+        proxy.move_y = box.min_y - proxy.y;
+        proxy.y = box.min_y;
+    }
+
+    //most moves stay inside the fat box and cost nothing
+    if(contains(m_nodes[proxy.node].box, box) == true)
+    {
+        return;
+    }
+
+    int stretch_x = getStretch(proxy.move_x);
+    int stretch_y = getStretch(proxy.move_y);
+
+    AABB fat = fatten(box);
+    if(stretch_x < 0)
+    {
+        fat.min_x += stretch_x;
+    }
+    else
+    {
+        fat.max_x += stretch_x;
+    }
+    if(stretch_y < 0)
+    {
+        fat.min_y += stretch_y;
+    }
+    else
+    {
+        fat.max_y += stretch_y;
+    }
+
+    //reinsert below the closest former ancestor that still holds the leaf,
+    //the nodes above it keep their boxes and the walk stays short
+    int start = removeLeaf(proxy.node);
+    while(start != NULL_NODE && contains(m_nodes[start].box, fat) == false)
+    {
+        start = m_nodes[start].parent;
+    }
+
+    m_nodes[proxy.node].box = fat;
+    insertLeaf(proxy.node, start);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::insertLeaf(int leaf, int start)
+{
+    if(m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    //walk down to the sibling that grows the tree's perimeter the least
+    AABB leaf_box = m_nodes[leaf].box;
+    int index = start != NULL_NODE ? start : m_root;
+    while(m_nodes[index].isLeaf() == false)
+    {
+        const Node &node = m_nodes[index];
+        int64_t area = perimeter(node.box);
+        int64_t combined_area = perimeter(combine(node.box, leaf_box));
+
+        //new parent here, or pay the growth of this node and descend
+        int64_t cost = 2 * combined_area;
+        int64_t inheritance = 2 * (combined_area - area);
+
+        int64_t child_costs[2];
+        const int children[2] = {node.child_1, node.child_2};
+        for(uint i = 0; i < 2; i++)
+        {
+            const Node &child = m_nodes[children[i]];
+            int64_t grown = perimeter(combine(child.box, leaf_box));
+            child_costs[i] = (child.isLeaf() == true ? grown : grown - perimeter(child.box)) +
+                             inheritance;
+        }
+
+        if(cost < child_costs[0] && cost < child_costs[1])
+        {
+            break;
+        }
+        index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+    }
+
+    int sibling = index;
+    int old_parent = m_nodes[sibling].parent;
+    int new_parent = allocateNode();
+
+    Node &parent = m_nodes[new_parent];
+    parent.parent = old_parent;
+    parent.box = combine(leaf_box, m_nodes[sibling].box);
+    parent.height = m_nodes[sibling].height + 1;
+    parent.child_1 = sibling;
+    parent.child_2 = leaf;
+
+    if(old_parent != NULL_NODE)
+    {
+        if(m_nodes[old_parent].child_1 == sibling)
+        {
+            m_nodes[old_parent].child_1 = new_parent;
+        }
+        else
+        {
+            m_nodes[old_parent].child_2 = new_parent;
+        }
+    }
+    else
+    {
+        m_root = new_parent;
+    }
+
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+
+    refit(new_parent);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int AABBTree::removeLeaf(int leaf)
+{
+    if(leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return NULL_NODE;
+    }
+
+    //the parent goes away, the sibling takes its place
+    int parent = m_nodes[leaf].parent;
+    int grand_parent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].child_1 == leaf ? m_nodes[parent].child_2
+                                                  : m_nodes[parent].child_1;
+
+    if(grand_parent != NULL_NODE)
+    {
+        if(m_nodes[grand_parent].child_1 == parent)
+        {
+            m_nodes[grand_parent].child_1 = sibling;
+        }
+        else
+        {
+            m_nodes[grand_parent].child_2 = sibling;
+        }
+        m_nodes[sibling].parent = grand_parent;
+        freeNode(parent);
+
+        refit(grand_parent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+    }
+
+    //still an ancestor of the sibling, rotations only move nodes downwards
+    return grand_parent;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::refit(int node)
+{
+    //the first node always changed, it got a new child
+    bool first = true;
+    while(node != NULL_NODE)
+    {
+        AABB old_box = m_nodes[node].box;
+        int old_height = m_nodes[node].height;
+
+        node = balance(node);
+
+        Node &current = m_nodes[node];
+        const Node &child_1 = m_nodes[current.child_1];
+        const Node &child_2 = m_nodes[current.child_2];
+        current.height = 1 + std::max(child_1.height, child_2.height);
+        current.box = combine(child_1.box, child_2.box);
+
+        //the ancestors were computed from exactly this box and height
+        if(first == false && current.height == old_height &&
+           memcmp(&current.box, &old_box, sizeof(AABB)) == 0)
+        {
+            break;
+        }
+        first = false;
+
+        node = current.parent;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int AABBTree::balance(int a)
+{
+    Node &node_a = m_nodes[a];
+    if(node_a.isLeaf() == true || node_a.height < 2)
+    {
+        return a;
+    }
+
+    int b = node_a.child_1;
+    int c = node_a.child_2;
+    Node &node_b = m_nodes[b];
+    Node &node_c = m_nodes[c];
+    int difference = node_c.height - node_b.height;
+
+    //rotate the taller child up, a takes the place of its shorter child
+    if(difference > 1 || difference < -1)
+    {
+        int up = difference > 1 ? c : b;
+        int stays = difference > 1 ? b : c;
+        Node &node_up = m_nodes[up];
+        int f = node_up.child_1;
+        int g = node_up.child_2;
+
+        node_up.child_1 = a;
+        node_up.parent = node_a.parent;
+        node_a.parent = up;
+
+        if(node_up.parent != NULL_NODE)
+        {
+            if(m_nodes[node_up.parent].child_1 == a)
+            {
+                m_nodes[node_up.parent].child_1 = up;
+            }
+            else
+            {
+                m_nodes[node_up.parent].child_2 = up;
+            }
+        }
+        else
+        {
+            m_root = up;
+        }
+
+        //the taller grandchild stays with up, the other one moves to a
+        int keep = m_nodes[f].height > m_nodes[g].height ? f : g;
+        int move = keep == f ? g : f;
+
+        node_up.child_2 = keep;
+        if(difference > 1)
+        {
+            node_a.child_2 = move;
+        }
+        else
+        {
+            node_a.child_1 = move;
+        }
+        m_nodes[move].parent = a;
+
+        node_a.box = combine(m_nodes[stays].box, m_nodes[move].box);
+        node_a.height = 1 + std::max(m_nodes[stays].height, m_nodes[move].height);
+        node_up.box = combine(node_a.box, m_nodes[keep].box);
+        node_up.height = 1 + std::max(node_a.height, m_nodes[keep].height);
+
+        return up;
+    }
+
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::query(const SDL_Rect &area, vector<GraphicsObject*> &result) const
+{
+    if(m_root == NULL_NODE)
+    {
+        return;
+    }
+
+    AABB box = toAABB(area);
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while(m_stack.empty() == false)
+    {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        if(overlaps(node.box, box) == false)
+        {
+            continue;
+        }
+
+        if(node.isLeaf() == true)
+        {
+            result.push_back(node.object);
+        }
+        else
+        {
+            m_stack.push_back(node.child_1);
+            m_stack.push_back(node.child_2);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AABBTree::queryPairs(vector<pair<GraphicsObject*, GraphicsObject*> > &result) const
+{
+    for(uint leaf = 0; leaf < m_nodes.size(); leaf++)
+    {
+        if(m_nodes[leaf].height != 0 || m_nodes[leaf].object == NULL)
+        {
+            continue;
+        }
+
+        GraphicsObject *object = m_nodes[leaf].object;
+        AABB box = toAABB(*(object->getDst().get()));
+
+        m_stack.clear();
+        m_stack.push_back(m_root);
+        while(m_stack.empty() == false)
+        {
+            int index = m_stack.back();
+            const Node &node = m_nodes[index];
+            m_stack.pop_back();
+
+            if(overlaps(node.box, box) == false)
+            {
+                continue;
+            }
+
+            if(node.isLeaf() == false)
+            {
+                m_stack.push_back(node.child_1);
+                m_stack.push_back(node.child_2);
+            }
+            //the lower node index reports the pair
+            else if(index > static_cast<int>(leaf) &&
+                    overlaps(toAABB(*(node.object->getDst().get())), box) == true)
+            {
+                result.push_back(std::make_pair(object, node.object));
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+GraphicsObject* AABBTree::raycast(float x0, float y0, float x1, float y1,
+                                  float *fraction) const
+{
+    GraphicsObject *hit = NULL;
+    float closest = 1.0f;
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+
+    if(m_root == NULL_NODE)
+    {
+        return NULL;
+    }
+
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    while(m_stack.empty() == false)
+    {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+
+        //subtrees entered behind the closest hit can not do better
+        float entry;
+        if(intersectSegment(node.box, x0, y0, dx, dy, closest, &entry) == false)
+        {
+            continue;
+        }
+
+        if(node.isLeaf() == false)
+        {
+            m_stack.push_back(node.child_1);
+            m_stack.push_back(node.child_2);
+        }
+        else if(intersectSegment(toAABB(*(node.object->getDst().get())),
+                                 x0, y0, dx, dy, closest, &entry) == true &&
+                (hit == NULL || entry < closest))
+        {
+            hit = node.object;
+            closest = entry;
+        }
+    }
+
+    if(hit != NULL && fraction != NULL)
+    {
+        *fraction = closest;
+    }
+    return hit;
+}
@@ -0,0 +1,175 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <vector>
+#include <utility>
+
+#include "common.h"
+
+using std::vector;
+using std::pair;
+
+class GraphicsObject;
+class AABBTree;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! bookkeeping a GraphicsObject carries while it is in a tree
+struct AABBTreeProxy
+{
+    AABBTreeProxy() :
+        tree(NULL),
+        node(-1),
+        x(0),
+        y(0),
+        move_x(0),
+        move_y(0)
+    {
+    }
+
+    AABBTree *tree;
+    int node;
+
+    //tight position at the last update and the last step on each axis
+    int x;
+    int y;
+    int move_x;
+    int move_y;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! axis aligned box in map pixels, max is exclusive like SDL_Rect
+struct AABB
+{
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Dynamic bounding volume hierarchy broadphase. Leaves store boxes
+//! fattened by AABB_MARGIN, small moves only compare against the fat box
+//! and leave the tree alone. Inserts pick the sibling with the lowest
+//! perimeter cost, rotations keep the tree balanced.
+class AABBTree
+{
+    DISABLECOPY(AABBTree);
+
+    public:
+        AABBTree();
+        ~AABBTree();
+
+        void insert(GraphicsObject *obj);
+        void remove(GraphicsObject *obj);
+
+        //! call after the destination rect of obj changed
+        void update(GraphicsObject *obj);
+
+        //! appends every object whose fat box overlaps area (no duplicates)
+        void query(const SDL_Rect &area, vector<GraphicsObject*> &result) const;
+
+        //! appends every pair of objects whose rects overlap, once per pair
+        void queryPairs(vector<pair<GraphicsObject*, GraphicsObject*> > &result) const;
+
+        //! first object hit by the segment from x0/y0 to x1/y1, fraction is
+        //! the hit position along the segment (0.0 - 1.0)
+        GraphicsObject* raycast(float x0, float y0, float x1, float y1,
+                                float *fraction = NULL) const;
+
+        inline uint getObjectCount() const
+        {
+            return m_object_count;
+        }
+
+        //! 0 for an empty tree, a single leaf has height 0
+        inline int getHeight() const
+        {
+            return m_root == NULL_NODE ? 0 : m_nodes[m_root].height;
+        }
+
+    private:
+        struct Node
+        {
+            AABB box;
+            GraphicsObject *object;
+            //next free node while the node is unused
+            int parent;
+            int child_1;
+            int child_2;
+            //leaves are 0, free nodes -1
+            int height;
+
+            inline bool isLeaf() const
+            {
+                return child_1 == NULL_NODE;
+            }
+        };
+
+        static const int NULL_NODE = -1;
+        //! pixels a leaf box is grown on every side
+        static const int AABB_MARGIN = 8;
+        //! a reinserted box is stretched by this many times the last step
+        //! of its object (about half a second at 60 ticks), objects on a
+        //! steady path leave it later
+        static const int AABB_DISPLACEMENT_MULTIPLIER = 32;
+
+        int allocateNode();
+        void freeNode(int node);
+        //! start is a node whose box already holds the leaf, NULL_NODE
+        //! searches from the root
+        void insertLeaf(int leaf, int start = NULL_NODE);
+        //! returns the lowest node that was an ancestor of leaf
+        int removeLeaf(int leaf);
+        int balance(int node);
+        //! recomputes boxes and heights from node upwards, stops at the
+        //! first subtree that did not change
+        void refit(int node);
+
+        static AABB toAABB(const SDL_Rect &rect);
+        static AABB fatten(const AABB &box);
+        //! how far a reinserted box reaches ahead of a step of move pixels
+        static int getStretch(int move);
+
+        vector<Node> m_nodes;
+        int m_root;
+        int m_free_list;
+        uint m_object_count;
+
+        //traversal stack, kept to avoid allocating per query
+        mutable vector<int> m_stack;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
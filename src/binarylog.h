@@ -0,0 +1,234 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "common.h"
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Binary log format, written by Logger::startBinary and turned back into
+// text by storyofanerd_logdecoder
+//
+// A BinaryLogHeader is followed by a stream of records in host byte order.
+// Every record starts with its uint8_t BinaryLogRecordType:
+//
+//  BINLOG_FORMAT   uint32_t id, uint8_t level, uint8_t category,
+//                  uint32_t line, string file, string format
+//  BINLOG_MESSAGE  uint32_t id, uint64_t monotonic time (ns),
+//                  uint16_t argument bytes, arguments
+//
+// A format record is written once per call site before its first message,
+// level and category never change for a call site so they live there.
+// Arguments are a uint8_t BinaryLogArgument tag followed by the raw value,
+// strings are a uint16_t length followed by the characters.
+//
+///////////////////////////////////////////////////////////////////////////
+
+static const char       BINARYLOG_MAGIC[4]  = { 'S', 'O', 'A', 'L' };
+static const uint32_t   BINARYLOG_VERSION   = 1;
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryLogHeader
+{
+    char        magic[4];
+    uint32_t    version;
+
+    //the same instant on both clocks, message times are monotonic
+    int64_t     realtime_ns;
+    int64_t     monotonic_ns;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+enum BinaryLogRecordType
+{
+    BINLOG_FORMAT   = 1,
+    BINLOG_MESSAGE  = 2
+};
+
+enum BinaryLogArgument
+{
+    BINLOG_ARG_INT32    = 1,
+    BINLOG_ARG_UINT32   = 2,
+    BINLOG_ARG_INT64    = 3,
+    BINLOG_ARG_UINT64   = 4,
+    BINLOG_ARG_DOUBLE   = 5,
+    BINLOG_ARG_STRING   = 6,
+    BINLOG_ARG_POINTER  = 7
+};
+
+//! type + id + time + argument bytes
+static const size_t BINARYLOG_MESSAGE_HEADER_SIZE = 15;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Serializes into a fixed buffer, values that do not fit are left out
+//! and strings are cut to the space that is left
+class BinaryLogEncoder
+{
+    DISABLECOPY(BinaryLogEncoder);
+
+    public:
+        BinaryLogEncoder(char *buffer, size_t capacity) :
+            m_buffer(buffer), m_capacity(capacity), m_size(0)
+        {
+        }
+
+        inline size_t getSize() const
+        {
+            return m_size;
+        }
+
+        template<typename T>
+        inline bool putRaw(T value)
+        {
+            if(m_size + sizeof(T) > m_capacity)
+            {
+                return false;
+            }
+            memcpy(m_buffer + m_size, &value, sizeof(T));
+            m_size += sizeof(T);
+            return true;
+        }
+
+        void putString(const char *value, size_t length)
+        {
+            if(m_size + sizeof(uint16_t) > m_capacity)
+            {
+                return;
+            }
+
+            size_t space = m_capacity - m_size - sizeof(uint16_t);
+            if(length > space)
+            {
+                length = space;
+            }
+            if(length > UINT16_MAX)
+            {
+                length = UINT16_MAX;
+            }
+
+            putRaw(static_cast<uint16_t>(length));
+            memcpy(m_buffer + m_size, value, length);
+            m_size += length;
+        }
+
+        //printf promotes everything narrower than int, so do we
+        inline void put(int value)
+        {
+            putArgument(BINLOG_ARG_INT32, static_cast<int32_t>(value));
+        }
+
+        inline void put(unsigned int value)
+        {
+            putArgument(BINLOG_ARG_UINT32, static_cast<uint32_t>(value));
+        }
+
+        inline void put(long value)
+        {
+            putArgument(BINLOG_ARG_INT64, static_cast<int64_t>(value));
+        }
+
+        inline void put(unsigned long value)
+        {
+            putArgument(BINLOG_ARG_UINT64, static_cast<uint64_t>(value));
+        }
+
+        inline void put(long long value)
+        {
+            putArgument(BINLOG_ARG_INT64, static_cast<int64_t>(value));
+        }
+
+        inline void put(unsigned long long value)
+        {
+            putArgument(BINLOG_ARG_UINT64, static_cast<uint64_t>(value));
+        }
+
+        inline void put(double value)
+        {
+            putArgument(BINLOG_ARG_DOUBLE, value);
+        }
+
+        inline void put(const void *value)
+        {
+            putArgument(BINLOG_ARG_POINTER, reinterpret_cast<uint64_t>(value));
+        }
+
+        void put(const char *value)
+        {
+            if(value == NULL)
+            {
+                value = "(null)";
+            }
+
+            if(putRaw(static_cast<uint8_t>(BINLOG_ARG_STRING)) == true)
+            {
+                putString(value, strlen(value));
+            }
+        }
+
+    private:
+        template<typename T>
+        inline void putArgument(BinaryLogArgument tag, T value)
+        {
+            //tag and value together or not at all
+            if(m_size + 1 + sizeof(T) <= m_capacity)
+            {
+                putRaw(static_cast<uint8_t>(tag));
+                putRaw(value);
+            }
+        }
+
+        char    *m_buffer;
+        size_t  m_capacity;
+        size_t  m_size;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+inline void encodeLogArguments(BinaryLogEncoder &encoder)
+{
+    UNUSED(encoder);
+}
+
+template<typename T, typename... Args>
+inline void encodeLogArguments(BinaryLogEncoder &encoder, const T &value,
+                               const Args&... args)
+{
+    encoder.put(value);
+    encodeLogArguments(encoder, args...);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
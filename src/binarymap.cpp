@@ -0,0 +1,513 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "xmlloader.h"
+#include "binarymap.h"
+#include "logging.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! collects the tables of a compiled map before they are written
+class BinaryMapWriter
+{
+    public:
+        BinaryMapString addString(const string &value)
+        {
+            BinaryMapString ref;
+            ref.offset = m_strings.size();
+            ref.length = value.size();
+            m_strings.insert(m_strings.end(), value.begin(), value.end());
+            return ref;
+        }
+
+        uint32_t addProperties(const map<string, string> &properties)
+        {
+            uint32_t first = m_properties.size();
+            for(map<string, string>::const_iterator it = properties.begin();
+                it != properties.end(); ++it)
+            {
+                BinaryMapProperty property;
+                property.name = addString(it->first);
+                property.value = addString(it->second);
+                m_properties.push_back(property);
+            }
+            return first;
+        }
+
+        vector<BinaryMapTileSet>        m_tilesets;
+        vector<BinaryMapTerrain>        m_terrains;
+        vector<BinaryMapTile>           m_tiles;
+        vector<BinaryMapProperty>       m_properties;
+        vector<BinaryMapLayer>          m_layers;
+        vector<BinaryMapObjectGroup>    m_objectgroups;
+        vector<BinaryMapObject>         m_objects;
+        vector<char>                    m_strings;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+static uint32_t placeSection(const vector<T> &table, uint64_t *offset,
+                             BinaryMapSection *section)
+{
+    section->offset = static_cast<uint32_t>(*offset);
+    section->count = table.size();
+    *offset += table.size() * sizeof(T);
+    return section->offset;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+template<typename T>
+static bool writeSection(FILE *file, const vector<T> &table)
+{
+    return table.empty() || fwrite(&table[0], sizeof(T), table.size(), file) == table.size();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline bool isLittleEndianHost()
+{
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode LoadedMap::saveBinaryFile(const string &filename) const
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::saveBinaryFile start\n");
+
+    if(isLittleEndianHost() == false)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::saveBinaryFile: "
+                          "Compiled maps are little endian only\n");
+        return ERROR_UNKNOWN;
+    }
+
+    BinaryMapWriter writer;
+
+    for(uint i = 0; i < m_tilesets.size(); i++)
+    {
+        const TileSet &tileset = m_tilesets.at(i);
+
+        BinaryMapTileSet record;
+        record.name             = writer.addString(tileset.name);
+        record.firstgid         = tileset.firstgid;
+        record.tilewidth        = tileset.tilewidth;
+        record.tileheight       = tileset.tileheight;
+        record.spacing          = tileset.spacing;
+        record.margin           = tileset.margin;
+        record.image_source     = writer.addString(tileset.image.source_image);
+        record.image_width      = tileset.image.width;
+        record.image_height     = tileset.image.height;
+        record.terrain_first    = writer.m_terrains.size();
+        record.terrain_count    = tileset.terraintypes.size();
+        record.tile_first       = writer.m_tiles.size();
+        record.tile_count       = tileset.tiles.size();
+        writer.m_tilesets.push_back(record);
+
+        for(uint j = 0; j < tileset.terraintypes.size(); j++)
+        {
+            const TerrainType &terrain = tileset.terraintypes.at(j);
+
+            BinaryMapTerrain terrain_record;
+            terrain_record.name             = writer.addString(terrain.name);
+            terrain_record.tile             = terrain.tile;
+            terrain_record.property_count   = terrain.properties.size();
+            terrain_record.property_first   = writer.addProperties(terrain.properties);
+            writer.m_terrains.push_back(terrain_record);
+        }
+
+        for(uint j = 0; j < tileset.tiles.size(); j++)
+        {
+            const Tile &tile = tileset.tiles.at(j);
+            const TerrainType *corners[4] = { tile.terrain_1, tile.terrain_2,
+                                              tile.terrain_3, tile.terrain_4 };
+
+            BinaryMapTile tile_record;
+            tile_record.id = tile.id;
+            for(uint k = 0; k < 4; k++)
+            {
+                tile_record.terrain[k] = (corners[k] != NULL) ?
+                                         corners[k] - &tileset.terraintypes[0] : -1;
+            }
+            writer.m_tiles.push_back(tile_record);
+        }
+    }
+
+    //gid arrays go behind all tables, their offsets are patched below
+    for(uint i = 0; i < m_layers.size(); i++)
+    {
+        const Layer &layer = m_layers.at(i);
+
+        BinaryMapLayer record;
+        record.name         = writer.addString(layer.name);
+        record.width        = layer.width;
+        record.height       = layer.height;
+        record.gids_offset  = 0;
+        writer.m_layers.push_back(record);
+    }
+
+    for(uint i = 0; i < m_objectgroups.size(); i++)
+    {
+        const ObjectGroup &group = m_objectgroups.at(i);
+
+        BinaryMapObjectGroup record;
+        record.draworder        = writer.addString(group.draworder);
+        record.name             = writer.addString(group.name);
+        record.width            = group.width;
+        record.height           = group.height;
+        record.property_count   = group.properties.size();
+        record.property_first   = writer.addProperties(group.properties);
+        record.object_first     = writer.m_objects.size();
+        record.object_count     = group.objects.size();
+        writer.m_objectgroups.push_back(record);
+
+        for(uint j = 0; j < group.objects.size(); j++)
+        {
+            const Object &object = group.objects.at(j);
+
+            BinaryMapObject object_record;
+            object_record.name      = writer.addString(object.name);
+            object_record.x         = object.bbox.x;
+            object_record.y         = object.bbox.y;
+            object_record.width     = object.bbox.w;
+            object_record.height    = object.bbox.h;
+            writer.m_objects.push_back(object_record);
+        }
+    }
+
+    BinaryMapHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINARYMAP_MAGIC, sizeof(header.magic));
+    header.version      = BINARYMAP_VERSION;
+    header.width        = m_map.width;
+    header.height       = m_map.height;
+    header.tilewidth    = m_map.tilewidth;
+    header.tileheight   = m_map.tileheight;
+
+    //64 bit, large maps must fail instead of wrapping the offsets
+    uint64_t offset = sizeof(BinaryMapHeader);
+    placeSection(writer.m_tilesets, &offset, &header.tilesets);
+    placeSection(writer.m_terrains, &offset, &header.terrains);
+    placeSection(writer.m_tiles, &offset, &header.tiles);
+    placeSection(writer.m_properties, &offset, &header.properties);
+    placeSection(writer.m_layers, &offset, &header.layers);
+    placeSection(writer.m_objectgroups, &offset, &header.objectgroups);
+    placeSection(writer.m_objects, &offset, &header.objects);
+
+    header.strings.offset = offset;
+    header.strings.count = writer.m_strings.size();
+    offset += writer.m_strings.size();
+
+    //keep the gid arrays aligned for in place access
+    uint32_t string_padding = (4 - (offset % 4)) % 4;
+    offset += string_padding;
+
+    for(uint i = 0; i < writer.m_layers.size(); i++)
+    {
+        //offsets only increase, checking where each gid array starts is enough
+        if(offset > UINT32_MAX)
+        {
+            LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::saveBinaryFile: "
+                              "%s does not fit the 32 bit offsets\n", filename.c_str());
+            return ERROR_INVALID_DATA;
+        }
+
+        writer.m_layers.at(i).gids_offset = static_cast<uint32_t>(offset);
+        offset += static_cast<uint64_t>(m_layers.at(i).width) * m_layers.at(i).height * sizeof(uint32_t);
+    }
+
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    const char padding[4] = { 0, 0, 0, 0 };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   writeSection(file, writer.m_tilesets) &&
+                   writeSection(file, writer.m_terrains) &&
+                   writeSection(file, writer.m_tiles) &&
+                   writeSection(file, writer.m_properties) &&
+                   writeSection(file, writer.m_layers) &&
+                   writeSection(file, writer.m_objectgroups) &&
+                   writeSection(file, writer.m_objects) &&
+                   writeSection(file, writer.m_strings) &&
+                   fwrite(padding, 1, string_padding, file) == string_padding;
+
+    for(uint i = 0; written && i < m_layers.size(); i++)
+    {
+        size_t count = static_cast<size_t>(m_layers.at(i).width) * m_layers.at(i).height;
+        written = count == 0 ||
+                  fwrite(getLayerGids(i), sizeof(uint32_t), count, file) == count;
+    }
+
+    if(fclose(file) != 0 || written == false)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::saveBinaryFile: "
+                          "Unable to write %s\n", filename.c_str());
+        return ERROR_OPENING_FILE;
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::saveBinaryFile end\n");
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! bounds checked access to the tables of a mapped compiled map
+class BinaryMapReader
+{
+    public:
+        BinaryMapReader(const char *data, size_t size) :
+            m_data(data),
+            m_size(size),
+            m_header(reinterpret_cast<const BinaryMapHeader*>(data)),
+            m_valid(true)
+        {
+        }
+
+        template<typename T>
+        const T* section(const BinaryMapSection &section)
+        {
+            if(checkRange(section.offset, static_cast<uint64_t>(section.count) * sizeof(T)) == false ||
+               section.offset % 4 != 0)
+            {
+                m_valid = false;
+                return NULL;
+            }
+            return reinterpret_cast<const T*>(m_data + section.offset);
+        }
+
+        string getString(const BinaryMapString &ref)
+        {
+            if(static_cast<uint64_t>(ref.offset) + ref.length > m_header->strings.count)
+            {
+                m_valid = false;
+                return "";
+            }
+            return string(m_data + m_header->strings.offset + ref.offset, ref.length);
+        }
+
+        void getProperties(const BinaryMapProperty *table, uint32_t first,
+                           uint32_t count, map<string, string> &target)
+        {
+            if(checkIndex(first, count, m_header->properties.count) == false)
+            {
+                return;
+            }
+            for(uint32_t i = first; i < first + count; i++)
+            {
+                target.insert(std::make_pair(getString(table[i].name),
+                                             getString(table[i].value)));
+            }
+        }
+
+        bool checkIndex(uint32_t first, uint32_t count, uint32_t table_size)
+        {
+            if(static_cast<uint64_t>(first) + count > table_size)
+            {
+                m_valid = false;
+            }
+            return m_valid;
+        }
+
+        bool checkRange(uint64_t offset, uint64_t length) const
+        {
+            return offset + length <= m_size;
+        }
+
+        inline bool isValid() const
+        {
+            return m_valid;
+        }
+
+    private:
+        const char  *m_data;
+        size_t      m_size;
+        const BinaryMapHeader *m_header;
+        bool        m_valid;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode LoadedMap::loadBinaryFile()
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadBinaryFile start\n");
+
+    const char *data = m_mapped_file.getData();
+    size_t size = m_mapped_file.getSize();
+
+    const BinaryMapHeader *header = reinterpret_cast<const BinaryMapHeader*>(data);
+    if(size < sizeof(BinaryMapHeader) || header->version != BINARYMAP_VERSION ||
+       isLittleEndianHost() == false)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::loadBinaryFile: "
+                          "Unsupported compiled map %s\n", m_filename.c_str());
+        return ERROR_INVALID_DATA;
+    }
+
+    BinaryMapReader reader(data, size);
+    if(reader.checkRange(header->strings.offset, header->strings.count) == false)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    const BinaryMapTileSet *tilesets = reader.section<BinaryMapTileSet>(header->tilesets);
+    const BinaryMapTerrain *terrains = reader.section<BinaryMapTerrain>(header->terrains);
+    const BinaryMapTile *tiles = reader.section<BinaryMapTile>(header->tiles);
+    const BinaryMapProperty *properties = reader.section<BinaryMapProperty>(header->properties);
+    const BinaryMapLayer *layers = reader.section<BinaryMapLayer>(header->layers);
+    const BinaryMapObjectGroup *objectgroups = reader.section<BinaryMapObjectGroup>(header->objectgroups);
+    const BinaryMapObject *objects = reader.section<BinaryMapObject>(header->objects);
+
+    if(reader.isValid() == false)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    m_map.width         = header->width;
+    m_map.height        = header->height;
+    m_map.tilewidth     = header->tilewidth;
+    m_map.tileheight    = header->tileheight;
+
+    m_tilesets.resize(header->tilesets.count);
+    for(uint32_t i = 0; i < header->tilesets.count; i++)
+    {
+        const BinaryMapTileSet &record = tilesets[i];
+        TileSet &tileset = m_tilesets.at(i);
+
+        tileset.name                = reader.getString(record.name);
+        tileset.firstgid            = record.firstgid;
+        tileset.tilewidth           = record.tilewidth;
+        tileset.tileheight          = record.tileheight;
+        tileset.spacing             = record.spacing;
+        tileset.margin              = record.margin;
+        tileset.image.source_image  = reader.getString(record.image_source);
+        tileset.image.width         = record.image_width;
+        tileset.image.height        = record.image_height;
+
+        if(reader.checkIndex(record.terrain_first, record.terrain_count, header->terrains.count) == false ||
+           reader.checkIndex(record.tile_first, record.tile_count, header->tiles.count) == false)
+        {
+            return ERROR_INVALID_DATA;
+        }
+
+        tileset.terraintypes.resize(record.terrain_count);
+        for(uint32_t j = 0; j < record.terrain_count; j++)
+        {
+            const BinaryMapTerrain &terrain = terrains[record.terrain_first + j];
+            tileset.terraintypes.at(j).name = reader.getString(terrain.name);
+            tileset.terraintypes.at(j).tile = terrain.tile;
+            reader.getProperties(properties, terrain.property_first,
+                                 terrain.property_count, tileset.terraintypes.at(j).properties);
+        }
+
+        //terraintypes is complete, pointers into it stay valid now
+        tileset.tiles.resize(record.tile_count);
+        for(uint32_t j = 0; j < record.tile_count; j++)
+        {
+            const BinaryMapTile &tile = tiles[record.tile_first + j];
+            TerrainType **corners[4] = { &tileset.tiles.at(j).terrain_1,
+                                         &tileset.tiles.at(j).terrain_2,
+                                         &tileset.tiles.at(j).terrain_3,
+                                         &tileset.tiles.at(j).terrain_4 };
+
+            tileset.tiles.at(j).id = tile.id;
+            for(uint k = 0; k < 4; k++)
+            {
+                bool in_range = tile.terrain[k] >= 0 &&
+                                static_cast<uint32_t>(tile.terrain[k]) < record.terrain_count;
+                *corners[k] = in_range ? &tileset.terraintypes[tile.terrain[k]] : NULL;
+            }
+        }
+    }
+
+    m_layers.resize(header->layers.count);
+    for(uint32_t i = 0; i < header->layers.count; i++)
+    {
+        const BinaryMapLayer &record = layers[i];
+        Layer &layer = m_layers.at(i);
+
+        layer.name      = reader.getString(record.name);
+        layer.width     = record.width;
+        layer.height    = record.height;
+
+        uint64_t length = static_cast<uint64_t>(record.width) * record.height * sizeof(uint32_t);
+        if(reader.checkRange(record.gids_offset, length) == false || record.gids_offset % 4 != 0)
+        {
+            return ERROR_INVALID_DATA;
+        }
+
+        //no copy, the gids are used straight from the mapping
+        layer.mapped_gids = reinterpret_cast<const uint32_t*>(data + record.gids_offset);
+    }
+
+    m_objectgroups.resize(header->objectgroups.count);
+    for(uint32_t i = 0; i < header->objectgroups.count; i++)
+    {
+        const BinaryMapObjectGroup &record = objectgroups[i];
+        ObjectGroup &group = m_objectgroups.at(i);
+
+        group.draworder = reader.getString(record.draworder);
+        group.name      = reader.getString(record.name);
+        group.width     = record.width;
+        group.height    = record.height;
+        reader.getProperties(properties, record.property_first,
+                             record.property_count, group.properties);
+
+        if(reader.checkIndex(record.object_first, record.object_count, header->objects.count) == false)
+        {
+            return ERROR_INVALID_DATA;
+        }
+
+        group.objects.resize(record.object_count);
+        for(uint32_t j = 0; j < record.object_count; j++)
+        {
+            const BinaryMapObject &object = objects[record.object_first + j];
+            group.objects.at(j).name    = reader.getString(object.name);
+            group.objects.at(j).bbox.x  = object.x;
+            group.objects.at(j).bbox.y  = object.y;
+            group.objects.at(j).bbox.w  = object.width;
+            group.objects.at(j).bbox.h  = object.height;
+        }
+    }
+
+    if(reader.isValid() == false)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadBinaryFile end\n");
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,177 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef BINARYMAP_H
+#define BINARYMAP_H
+
+#include <stdint.h>
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Compiled map format (.cmap), written by storyofanerd_mapc
+//
+// All values are little endian uint32_t/int32_t. The header is followed by
+// tables of fixed size records, a string table and the gid arrays of the
+// layers. Strings are referenced as (offset, length) into the string
+// table, "first"/"count" pairs index into the next table down. Every table
+// and gid array starts at a 4 byte aligned offset so the loader can use
+// the mapped file in place.
+//
+///////////////////////////////////////////////////////////////////////////
+
+static const char       BINARYMAP_MAGIC[4]  = { 'S', 'O', 'A', 'M' };
+static const uint32_t   BINARYMAP_VERSION   = 1;
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapString
+{
+    uint32_t    offset;
+    uint32_t    length;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapSection
+{
+    uint32_t    offset;
+    uint32_t    count;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapHeader
+{
+    char        magic[4];
+    uint32_t    version;
+
+    uint32_t    width;
+    uint32_t    height;
+    uint32_t    tilewidth;
+    uint32_t    tileheight;
+
+    BinaryMapSection tilesets;
+    BinaryMapSection terrains;
+    BinaryMapSection tiles;
+    BinaryMapSection properties;
+    BinaryMapSection layers;
+    BinaryMapSection objectgroups;
+    BinaryMapSection objects;
+
+    //count is the size of the table in bytes
+    BinaryMapSection strings;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapTileSet
+{
+    BinaryMapString name;
+    uint32_t    firstgid;
+    uint32_t    tilewidth;
+    uint32_t    tileheight;
+    uint32_t    spacing;
+    uint32_t    margin;
+
+    BinaryMapString image_source;
+    uint32_t    image_width;
+    uint32_t    image_height;
+
+    uint32_t    terrain_first;
+    uint32_t    terrain_count;
+    uint32_t    tile_first;
+    uint32_t    tile_count;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapTerrain
+{
+    BinaryMapString name;
+    uint32_t    tile;
+    uint32_t    property_first;
+    uint32_t    property_count;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapTile
+{
+    uint32_t    id;
+
+    //index into the terrains of the tileset, -1 if not set
+    int32_t     terrain[4];
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapProperty
+{
+    BinaryMapString name;
+    BinaryMapString value;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapLayer
+{
+    BinaryMapString name;
+    uint32_t    width;
+    uint32_t    height;
+
+    //width * height gids
+    uint32_t    gids_offset;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapObjectGroup
+{
+    BinaryMapString draworder;
+    BinaryMapString name;
+    uint32_t    width;
+    uint32_t    height;
+
+    uint32_t    property_first;
+    uint32_t    property_count;
+    uint32_t    object_first;
+    uint32_t    object_count;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct BinaryMapObject
+{
+    BinaryMapString name;
+    int32_t     x;
+    int32_t     y;
+    int32_t     width;
+    int32_t     height;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
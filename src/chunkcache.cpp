@@ -0,0 +1,147 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "chunkcache.h"
+#include "graphics.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+ChunkCache::ChunkCache(int chunk_width, int chunk_height, size_t budget_bytes) :
+    m_chunk_width(chunk_width),
+    m_chunk_height(chunk_height),
+    //RGBA8888 render targets
+    m_chunk_bytes(static_cast<size_t>(chunk_width) * chunk_height * 4),
+    m_budget_bytes(budget_bytes),
+    m_frame(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ChunkCache::~ChunkCache()
+{
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+SDL_Texture* ChunkCache::find(int chunk_x, int chunk_y)
+{
+    unordered_map<uint64_t, list<Entry>::iterator>::iterator found =
+        m_lookup.find(chunkKey(chunk_x, chunk_y));
+
+    if(found == m_lookup.end() || found->second->valid == false)
+    {
+        return NULL;
+    }
+
+    //move to the front, O(1) and no reallocation
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    found->second->frame = m_frame;
+    return found->second->texture;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+SDL_Texture* ChunkCache::allocate(int chunk_x, int chunk_y)
+{
+    uint64_t key = chunkKey(chunk_x, chunk_y);
+
+    //invalidated chunks keep their texture, just bake into it again
+    unordered_map<uint64_t, list<Entry>::iterator>::iterator found = m_lookup.find(key);
+    if(found != m_lookup.end())
+    {
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        found->second->valid = true;
+        found->second->frame = m_frame;
+        return found->second->texture;
+    }
+
+    if(m_chunk_bytes > m_budget_bytes)
+    {
+        return NULL;
+    }
+
+    SDL_Texture *texture = NULL;
+    if(getUsedBytes() + m_chunk_bytes > m_budget_bytes)
+    {
+        //recycle the least recently used chunk
+        Entry &oldest = m_entries.back();
+        if(oldest.frame == m_frame)
+        {
+            return NULL;
+        }
+        m_lookup.erase(oldest.key);
+        texture = oldest.texture;
+        m_entries.pop_back();
+    }
+    else
+    {
+        texture = GraphicsCore::instance().createRenderTarget(m_chunk_width, m_chunk_height);
+        if(texture == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.texture = texture;
+    entry.valid = true;
+    entry.frame = m_frame;
+
+    m_entries.push_front(entry);
+    m_lookup[key] = m_entries.begin();
+    return texture;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ChunkCache::invalidate(int chunk_x, int chunk_y)
+{
+    unordered_map<uint64_t, list<Entry>::iterator>::iterator found =
+        m_lookup.find(chunkKey(chunk_x, chunk_y));
+
+    if(found != m_lookup.end())
+    {
+        found->second->valid = false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ChunkCache::clear()
+{
+    for(list<Entry>::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+    {
+        SDL_DestroyTexture(it->texture);
+    }
+
+    m_entries.clear();
+    m_lookup.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////
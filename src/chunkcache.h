@@ -0,0 +1,112 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+
+#include "core.h"
+
+using std::list;
+using std::unordered_map;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! LRU cache of baked map chunks (render target textures)
+//!
+//! All chunks have the same pixel size, so textures of evicted chunks
+//! are handed out again instead of being destroyed and recreated.
+class ChunkCache
+{
+    DISABLECOPY(ChunkCache);
+
+    public:
+        ChunkCache(int chunk_width, int chunk_height, size_t budget_bytes);
+        ~ChunkCache();
+
+        //! starts a new frame, chunks used in the current frame are never
+        //! recycled since their draw commands are still pending
+        inline void nextFrame()
+        {
+            m_frame++;
+        }
+
+        //! baked texture of the chunk, NULL if it has to be (re)baked
+        SDL_Texture* find(int chunk_x, int chunk_y);
+
+        //! texture to bake the chunk into, evicts the least recently used
+        //! chunks to stay within the budget; NULL if nothing fits
+        SDL_Texture* allocate(int chunk_x, int chunk_y);
+
+        //! the chunk is rebaked the next time it is needed
+        void invalidate(int chunk_x, int chunk_y);
+
+        //! drops all chunks, e.g. after the render targets were lost
+        void clear();
+
+        inline size_t getUsedBytes() const
+        {
+            return m_entries.size() * m_chunk_bytes;
+        }
+
+        inline uint getChunkCount() const
+        {
+            return m_entries.size();
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t     key;
+            SDL_Texture *texture;
+            bool         valid;
+            uint         frame;
+        };
+
+        inline uint64_t chunkKey(int chunk_x, int chunk_y) const
+        {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(chunk_x)) << 32) |
+                    static_cast<uint32_t>(chunk_y);
+        }
+
+        int m_chunk_width;
+        int m_chunk_height;
+        size_t m_chunk_bytes;
+        size_t m_budget_bytes;
+        uint m_frame;
+
+        //most recently used first
+        list<Entry> m_entries;
+        unordered_map<uint64_t, list<Entry>::iterator> m_lookup;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
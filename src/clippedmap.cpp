@@ -23,61 +23,114 @@
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  *-----------------------------------------------------------------------*/
-
 #include "clippedmap.h"
+#include "trace.h"
 #include <SDL2/SDL_image.h>
-#include <sstream>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline int floorDiv(int value, int divisor)
+{
+    return (value >= 0) ? value / divisor : -((-value - 1) / divisor) - 1;
+}
 
 ///////////////////////////////////////////////////////////////////////////
 
 ClippedMap::ClippedMap(LoadedMap *lmap) :
     GameObject("map"),
     m_loaded_map(lmap),
+    m_first_gid(lmap->getTileSetFirstGid(0)),
+    m_culling(false),
+    m_viewport_x(0),
+    m_viewport_y(0),
+    m_tile_data(NULL),
+    m_tile_set_surface(NULL),
+    m_tile_set(NULL),
+    m_targets_reset(false)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap start\n");
+
+    loadTexture(loadTileSetSurface(*lmap));
+    createClips();
+    findTileData();
+    createChunkCache();
+    setRenderLayer(RENDER_LAYER_MAP, DRAWORDER_NONE);
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap end\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ClippedMap::ClippedMap(shared_ptr<LoadedMap> lmap,
+                       shared_ptr<SDL_Surface> tile_set_surface) :
+    GameObject("map"),
+    m_loaded_map(lmap.get()),
+    m_owned_map(lmap),
+    m_first_gid(lmap->getTileSetFirstGid(0)),
+    m_culling(false),
+    m_viewport_x(0),
+    m_viewport_y(0),
+    m_tile_data(NULL),
     m_tile_set_surface(NULL),
-    m_tile_set(NULL)
+    m_tile_set(NULL),
+    m_targets_reset(false)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap start\n");
 
-    loadTexture();
+    loadTexture(tile_set_surface);
     createClips();
-    parseTileData();
+    findTileData();
+    createChunkCache();
+    setRenderLayer(RENDER_LAYER_MAP, DRAWORDER_NONE);
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::ClippedMap end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 ClippedMap::~ClippedMap()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::~ClippedMap\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::~ClippedMap\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void ClippedMap::copyTilesToRender(int viewport_x, int viewport_y)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::copyTilesToRender start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::copyTilesToRender start\n");
+    TRACE_ZONE("ClippedMap::copyTilesToRender");
+
+    m_culling = false;
+    m_viewport_x = viewport_x;
+    m_viewport_y = viewport_y;
+
+    if(m_tile_data == NULL)
+    {
+        return;
+    }
 
     uint x_coord = 0;
     uint y_coord = 0;
+    uint tile_count = m_loaded_map->getTileMap().width * m_loaded_map->getTileMap().height;
 
-    int current_clip = 0;
-    for(vector<int>::iterator it = m_tile_data_parsed.begin();
-        it != m_tile_data_parsed.end(); ++it)
+    uint32_t current_clip = 0;
+    for(uint i = 0; i < tile_count; i++)
     {
-        current_clip = *it;
+        current_clip = m_tile_data[i] & GID_MASK;
+        SDL_Rect *clip = getClip(current_clip);
 
-        shared_ptr<SDL_Rect> dst(new SDL_Rect());
-        dst->x = x_coord - viewport_x;
-        dst->y = y_coord - viewport_y;
+        if(clip != NULL)
+        {
+            shared_ptr<SDL_Rect> dst(new SDL_Rect());
+            dst->x = x_coord - viewport_x;
+            dst->y = y_coord - viewport_y;
 
-        dst->w = m_map_clips.at(current_clip).get()->w;
-        dst->h = m_map_clips.at(current_clip).get()->h;
+            dst->w = clip->w;
+            dst->h = clip->h;
 
-        if(current_clip != 0)
-        {
             shared_ptr<GraphicsObject> gobj(new GraphicsObject(m_tile_set,
-                                            m_map_clips.at(current_clip),
+                                            m_map_clips.at(current_clip - m_first_gid),
                                             dst));
             addGraphicsObject(gobj);
         }
@@ -90,81 +143,396 @@ void ClippedMap::copyTilesToRender(int viewport_x, int viewport_y)
         }
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::copyTilesToRender end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::copyTilesToRender end\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::setViewport(int viewport_x, int viewport_y)
+{
+    m_culling = true;
+    m_viewport_x = viewport_x;
+    m_viewport_y = viewport_y;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::drawAll(float alpha)
+{
+    if(m_culling == false)
+    {
+        GameObject::drawAll(alpha);
+        return;
+    }
+
+    //culling and chunk baking need the renderer, so the visible part is
+    //drawn when the queue is submitted; the viewport is captured now
+    SDL_Rect viewport;
+    viewport.x = m_viewport_x;
+    viewport.y = m_viewport_y;
+    viewport.w = 0;
+    viewport.h = 0;
+
+    GraphicsCore::instance().getRenderQueue().pushCallback(&ClippedMap::drawCallback, this,
+                                                           m_tile_set.get(), viewport,
+                                                           m_render_layer, m_draw_order);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::drawCallback(void *context, const RenderCommand &command)
+{
+    ClippedMap *map = static_cast<ClippedMap*>(context);
+
+    if(map->m_targets_reset.exchange(false) == true && map->m_chunk_cache.get() != NULL)
+    {
+        LOGMESSAGE(LOG_DEBUG, LOG_MAP, "ClippedMap::drawCallback: "
+                          "Render targets reset, dropping %u chunks\n",
+                          map->m_chunk_cache->getChunkCount());
+        map->m_chunk_cache->clear();
+    }
+
+    if(map->m_chunk_cache.get() != NULL)
+    {
+        map->drawVisibleChunks(command.dst.x, command.dst.y);
+    }
+    else
+    {
+        map->drawVisibleTiles(command.dst.x, command.dst.y);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::drawVisibleTiles(int viewport_x, int viewport_y)
+{
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+    const int tile_w = tile_map.tilewidth;
+    const int tile_h = tile_map.tileheight;
+
+    if(m_tile_data == NULL)
+    {
+        return;
+    }
+
+    int screen_w, screen_h;
+    GraphicsCore::instance().getOutputSize(&screen_w, &screen_h);
+
+    //visible tile range, everything outside is never touched
+    int first_col = std::max(0, floorDiv(viewport_x, tile_w));
+    int first_row = std::max(0, floorDiv(viewport_y, tile_h));
+    int last_col  = std::min(static_cast<int>(tile_map.width) - 1,
+                             floorDiv(viewport_x + screen_w - 1, tile_w));
+    int last_row  = std::min(static_cast<int>(tile_map.height) - 1,
+                             floorDiv(viewport_y + screen_h - 1, tile_h));
+
+    SDL_Rect dst;
+    dst.w = tile_w;
+    dst.h = tile_h;
+
+    for(int row = first_row; row <= last_row; row++)
+    {
+        const uint32_t *tile = &m_tile_data[row * tile_map.width];
+        dst.y = row * tile_h - viewport_y;
+
+        for(int col = first_col; col <= last_col; col++)
+        {
+            SDL_Rect *clip = getClip(tile[col]);
+            if(clip == NULL)
+            {
+                continue;
+            }
+
+            dst.x = col * tile_w - viewport_x;
+            GraphicsCore::instance().queueSprite(m_tile_set.get(), clip, dst);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::drawVisibleChunks(int viewport_x, int viewport_y)
+{
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+    const int chunk_w = CHUNK_TILES * tile_map.tilewidth;
+    const int chunk_h = CHUNK_TILES * tile_map.tileheight;
+
+    if(m_tile_data == NULL)
+    {
+        return;
+    }
+
+    int screen_w, screen_h;
+    GraphicsCore::instance().getOutputSize(&screen_w, &screen_h);
+
+    //chunks drawn this frame must not be recycled for another bake
+    m_chunk_cache->nextFrame();
+
+    int chunks_x = (tile_map.width + CHUNK_TILES - 1) / CHUNK_TILES;
+    int chunks_y = (tile_map.height + CHUNK_TILES - 1) / CHUNK_TILES;
+
+    int first_chunk_x = std::max(0, floorDiv(viewport_x, chunk_w));
+    int first_chunk_y = std::max(0, floorDiv(viewport_y, chunk_h));
+    int last_chunk_x  = std::min(chunks_x - 1, floorDiv(viewport_x + screen_w - 1, chunk_w));
+    int last_chunk_y  = std::min(chunks_y - 1, floorDiv(viewport_y + screen_h - 1, chunk_h));
+
+    SDL_Rect dst;
+    dst.w = chunk_w;
+    dst.h = chunk_h;
+
+    for(int chunk_y = first_chunk_y; chunk_y <= last_chunk_y; chunk_y++)
+    {
+        dst.y = chunk_y * chunk_h - viewport_y;
+
+        for(int chunk_x = first_chunk_x; chunk_x <= last_chunk_x; chunk_x++)
+        {
+            dst.x = chunk_x * chunk_w - viewport_x;
+
+            SDL_Texture *chunk = m_chunk_cache->find(chunk_x, chunk_y);
+            if(chunk == NULL)
+            {
+                chunk = m_chunk_cache->allocate(chunk_x, chunk_y);
+                if(chunk == NULL)
+                {
+                    //out of budget or textures, draw tile by tile
+                    drawChunkTiles(chunk_x, chunk_y, dst.x, dst.y);
+                    continue;
+                }
+
+                GraphicsCore::instance().setRenderTarget(chunk);
+                GraphicsCore::instance().clearRenderTarget();
+                drawChunkTiles(chunk_x, chunk_y, 0, 0);
+                GraphicsCore::instance().setRenderTarget(NULL);
+            }
+
+            GraphicsCore::instance().queueSprite(chunk, NULL, dst);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::drawChunkTiles(int chunk_x, int chunk_y, int offset_x, int offset_y)
+{
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+    const int tile_w = tile_map.tilewidth;
+    const int tile_h = tile_map.tileheight;
+
+    int first_col = chunk_x * CHUNK_TILES;
+    int first_row = chunk_y * CHUNK_TILES;
+    int last_col  = std::min(static_cast<int>(tile_map.width), first_col + CHUNK_TILES) - 1;
+    int last_row  = std::min(static_cast<int>(tile_map.height), first_row + CHUNK_TILES) - 1;
+
+    SDL_Rect dst;
+    dst.w = tile_w;
+    dst.h = tile_h;
+
+    for(int row = first_row; row <= last_row; row++)
+    {
+        const uint32_t *tile = &m_tile_data[row * tile_map.width];
+        dst.y = (row - first_row) * tile_h + offset_y;
+
+        for(int col = first_col; col <= last_col; col++)
+        {
+            SDL_Rect *clip = getClip(tile[col]);
+            if(clip == NULL)
+            {
+                continue;
+            }
+
+            dst.x = (col - first_col) * tile_w + offset_x;
+            GraphicsCore::instance().queueSprite(m_tile_set.get(), clip, dst);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::setTile(uint col, uint row, uint32_t gid)
+{
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+    if(m_tile_data == NULL || col >= tile_map.width || row >= tile_map.height)
+    {
+        return;
+    }
+
+    m_loaded_map->setLayerGid(0, row * tile_map.width + col, gid);
+
+    //compiled maps copy the layer on the first change
+    m_tile_data = m_loaded_map->getLayerGids(0);
+
+    if(m_chunk_cache.get() != NULL)
+    {
+        m_chunk_cache->invalidate(col / CHUNK_TILES, row / CHUNK_TILES);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool ClippedMap::handleKeyEvent(const InputEvent &event)
+{
+    //the cache belongs to the render thread, it is cleared before drawing
+    if(event == RENDER_TARGETS_RESET)
+    {
+        m_targets_reset = true;
+    }
+
+    //other maps need to see the event as well
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::createChunkCache()
+{
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+
+    if(GraphicsCore::instance().supportsRenderTargets() == false)
+    {
+        LOGMESSAGE(LOG_WARNING, LOG_MAP, "ClippedMap::createChunkCache: "
+                          "No render target support, drawing single tiles\n");
+        return;
+    }
+
+    m_chunk_cache.reset(new ChunkCache(CHUNK_TILES * tile_map.tilewidth,
+                                       CHUNK_TILES * tile_map.tileheight,
+                                       CHUNK_CACHE_BUDGET));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool ClippedMap::checkAreaCollision(const SDL_Rect &area) const
+{
+    if(m_tile_data == NULL)
+    {
+        return false;
+    }
+
+    //area is in screen coordinates, the collision map in map coordinates
+    SDL_Rect map_area = area;
+    map_area.x += m_viewport_x;
+    map_area.y += m_viewport_y;
+
+    return m_loaded_map->getCollisionMap(0).overlaps(map_area);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void ClippedMap::queryAreaColliders(const SDL_Rect &area, vector<SDL_Rect> &result) const
+{
+    if(m_tile_data == NULL)
+    {
+        return;
+    }
+
+    SDL_Rect map_area = area;
+    map_area.x += m_viewport_x;
+    map_area.y += m_viewport_y;
+
+    uint first = result.size();
+    m_loaded_map->getCollisionMap(0).queryColliders(map_area, result);
+
+    //back to screen coordinates
+    for(uint i = first; i < result.size(); i++)
+    {
+        result[i].x -= m_viewport_x;
+        result[i].y -= m_viewport_y;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void ClippedMap::createClips()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::createClips start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::createClips start\n");
 
     int tile_w  = m_loaded_map->getTileMap().tilewidth;
     int tile_h  = m_loaded_map->getTileMap().tileheight;
+    int spacing = m_loaded_map->getTileSetSpacing(0);
+    int margin  = m_loaded_map->getTileSetMargin(0);
 
     //TODO: naming
-    uint number_tiles_width  = m_surface_width / tile_w;
-    uint number_tiles_height = m_surface_height / tile_h;
+    uint number_tiles_width  = (m_surface_width - 2 * margin + spacing) / (tile_w + spacing);
+    uint number_tiles_height = (m_surface_height - 2 * margin + spacing) / (tile_h + spacing);
 
-    for(uint i = 0; i < number_tiles_width; i++)
+    //tile ids run row by row through the tileset image
+    for(uint j = 0; j < number_tiles_height; j++)
     {
-        for(uint j = 0; j < number_tiles_height; j++)
+        for(uint i = 0; i < number_tiles_width; i++)
         {
             shared_ptr<SDL_Rect> rect(new SDL_Rect());
-            rect.get()->x  = i + tile_w;
-            rect.get()->y  = j + tile_h;
+            rect.get()->x  = margin + i * (tile_w + spacing);
+            rect.get()->y  = margin + j * (tile_h + spacing);
             rect.get()->w  = tile_w;
             rect.get()->h  = tile_h;
             m_map_clips.push_back(rect);
         }
     }
 
-    Logger.logMessage(LOG_DEBUG, LOG_MAP, "ClippedMap::createClips: Created %d clips\n",
+    LOGMESSAGE(LOG_DEBUG, LOG_MAP, "ClippedMap::createClips: Created %d clips\n",
                       m_map_clips.size());
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::createClips end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::createClips end\n");
+}
+///////////////////////////////////////////////////////////////////////////
+
+shared_ptr<SDL_Surface> ClippedMap::loadTileSetSurface(const LoadedMap &lmap)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::loadTileSetSurface start\n");
+
+    string filename = lmap.getDirectory() + lmap.getImageName(0);
+    SDL_Surface *tile_set_surface = IMG_Load(filename.c_str());
+    if(tile_set_surface == NULL)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "ClippedMap::loadTileSetSurface: "
+                          "Unable to load %s\n", filename.c_str());
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::loadTileSetSurface end\n");
+    return shared_ptr<SDL_Surface>(tile_set_surface, SDL_FreeSurface);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void ClippedMap::loadTexture()
+void ClippedMap::loadTexture(shared_ptr<SDL_Surface> tile_set_surface)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::loadTexture start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::loadTexture start\n");
 
-    SDL_Surface *tile_set_surface = IMG_Load(("../res/maps/" + m_loaded_map->getImageName(0)).c_str());
-    assert(tile_set_surface);
+    assert(tile_set_surface.get());
 
-    SDL_Texture *tile_set = SDL_CreateTextureFromSurface(&(GraphicsCore::instance().getRenderer()), tile_set_surface);
+    SDL_Texture *tile_set = SDL_CreateTextureFromSurface(&(GraphicsCore::instance().getRenderer()),
+                                                         tile_set_surface.get());
     assert(tile_set);
 
-    m_tile_set_surface.reset(tile_set_surface, SDL_FreeSurface);
+    m_tile_set_surface = tile_set_surface;
     m_tile_set.reset(tile_set, SDL_DestroyTexture);
 
     m_surface_width = m_tile_set_surface->w;
     m_surface_height = m_tile_set_surface->h;
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::loadTexture end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::loadTexture end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void ClippedMap::parseTileData()
+void ClippedMap::findTileData()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::parseTileData start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::findTileData start\n");
 
-    string tile_data    = m_loaded_map->getLayerData(0);
-
-    std::stringstream ss(tile_data);
-    int vec_index;
-    while(ss >> vec_index)
+    const TileMap &tile_map = m_loaded_map->getTileMap();
+    if(m_loaded_map->getLayerCount() > 0 &&
+       m_loaded_map->getLayer(0).width == tile_map.width &&
+       m_loaded_map->getLayer(0).height == tile_map.height)
     {
-        m_tile_data_parsed.push_back(vec_index);
-        if(ss.peek() == ',')
-        {
-            ss.ignore();
-        }
+        //used in place, compiled maps point straight into the file
+        m_tile_data = m_loaded_map->getLayerGids(0);
+    }
+    else
+    {
+        LOGMESSAGE(LOG_WARNING, LOG_MAP, "ClippedMap::findTileData: "
+                          "No layer matching the map size\n");
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "ClippedMap::parseTileData end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "ClippedMap::findTileData end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -30,11 +30,13 @@
 #include <SDL2/SDL.h>
 #include <vector>
 #include <string>
+#include <atomic>
 
 #include "core.h"
 #include "graphics.h"
 #include "xmlloader.h"
 #include "gameobject.h"
+#include "chunkcache.h"
 
 using std::vector;
 using std::string;
@@ -45,25 +47,107 @@ class ClippedMap : public GameObject
 {
     public:
         explicit ClippedMap(LoadedMap *lmap);
+
+        //! for maps loaded in the background: the surface was already
+        //! loaded, only the texture upload happens here (render thread)
+        ClippedMap(shared_ptr<LoadedMap> lmap,
+                   shared_ptr<SDL_Surface> tile_set_surface);
         virtual ~ClippedMap();
 
+        //! loads the tileset image of lmap, safe to call from any thread
+        static shared_ptr<SDL_Surface> loadTileSetSurface(const LoadedMap &lmap);
+
 //        virtual void update();
+        //! creates one GraphicsObject per tile (static, no culling)
         void copyTilesToRender(int viewport_x, int viewport_y);
 
+        //! camera mode: only tiles inside the visible area are drawn,
+        //! viewport is the map position of the upper left screen corner
+        void setViewport(int viewport_x, int viewport_y);
+
+        virtual void drawAll(float alpha);
+
+        //! changes a tile of the drawn layer, only its chunk is rebaked
+        //! (camera mode only, copyTilesToRender objects are not updated).
+        //! Not synchronized with drawing, with the pipelined loop it must
+        //! not be called while a frame of this map is being submitted.
+        void setTile(uint col, uint row, uint32_t gid);
+
+        //! drops baked chunks when the render targets were lost
+        virtual bool handleKeyEvent(const InputEvent &event);
+
+        //! tiles never enter the broadphase, collision is answered by
+        //! checkAreaCollision from the collision map of the layer
+        virtual void setBroadphase(AABBTree *tree)
+        {
+            UNUSED(tree);
+        }
+
+        virtual bool usesAreaCollision() const
+        {
+            return true;
+        }
+
+        virtual bool checkAreaCollision(const SDL_Rect &area) const;
+        virtual void queryAreaColliders(const SDL_Rect &area, vector<SDL_Rect> &result) const;
+
+        inline const LoadedMap& getLoadedMap() const
+        {
+            return *m_loaded_map;
+        }
+
     private:
-        void loadTexture();
+        void loadTexture(shared_ptr<SDL_Surface> tile_set_surface);
         void createClips();
-        void parseTileData();
+        void findTileData();
+        //! render thread part of drawAll (RenderQueue callback)
+        static void drawCallback(void *context, const RenderCommand &command);
+        void drawVisibleTiles(int viewport_x, int viewport_y);
+        void createChunkCache();
+        void drawVisibleChunks(int viewport_x, int viewport_y);
+        void drawChunkTiles(int chunk_x, int chunk_y, int offset_x, int offset_y);
+
+        inline SDL_Rect* getClip(uint32_t gid) const
+        {
+            //flipping is not supported yet, only keep the tile id
+            gid = gid & GID_MASK;
+            uint32_t clip = gid - m_first_gid;
+            if(gid < m_first_gid || clip >= m_map_clips.size())
+            {
+                return NULL;
+            }
+            return m_map_clips[clip].get();
+        }
 
         LoadedMap *m_loaded_map;
+
+        //keeps maps alive that were handed over by the async loader
+        shared_ptr<LoadedMap> m_owned_map;
         int m_surface_width;
         int m_surface_height;
+        uint m_first_gid;
+
+        bool m_culling;
+        int m_viewport_x;
+        int m_viewport_y;
 
         vector<shared_ptr<SDL_Rect> > m_map_clips;
-        vector<int> m_tile_data_parsed;
+        //gids of the drawn layer, owned by the LoadedMap (NULL if none)
+        const uint32_t *m_tile_data;
 
         shared_ptr<SDL_Surface> m_tile_set_surface;
         shared_ptr<SDL_Texture> m_tile_set;
+
+        //set by handleKeyEvent, the render thread drops the chunks
+        std::atomic<bool> m_targets_reset;
+
+        //! tiles per chunk side, 512x512 pixels for 32px tiles
+        static const int CHUNK_TILES = 16;
+        //! 16 chunks of 32px tiles, a 640x480 view needs at most 6
+        static const size_t CHUNK_CACHE_BUDGET = 16 * 1024 * 1024;
+
+        //NULL if the renderer can't render to textures
+        shared_ptr<ChunkCache> m_chunk_cache;
         DISABLECOPY(ClippedMap);
 };
 
@@ -0,0 +1,276 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "collisionmap.h"
+#include "layerdecoder.h"
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////
+
+static inline int floorDiv(int value, int divisor)
+{
+    return (value >= 0) ? value / divisor : -((-value - 1) / divisor) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+CollisionMap::CollisionMap() :
+    m_width(0), m_height(0), m_words_per_row(0),
+    m_tile_width(1), m_tile_height(1),
+    m_regions_x(0), m_regions_y(0),
+    m_meshed(false), m_collider_count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void CollisionMap::build(uint width, uint height, uint tile_width, uint tile_height,
+                         const uint32_t *gids, const vector<uint8_t> &tile_masks,
+                         uint8_t default_mask)
+{
+    m_width = width * 2;
+    m_height = height * 2;
+    m_words_per_row = (m_width + 63) / 64;
+    m_tile_width = tile_width > 0 ? tile_width : 1;
+    m_tile_height = tile_height > 0 ? tile_height : 1;
+    m_bits.assign(static_cast<size_t>(m_words_per_row) * m_height, 0);
+
+    m_regions_x = m_words_per_row;
+    m_regions_y = (m_height + REGION_SIZE - 1) / REGION_SIZE;
+    m_region_colliders.assign(static_cast<size_t>(m_regions_x) * m_regions_y,
+                              vector<SDL_Rect>());
+    m_collider_count = 0;
+    m_meshed = false;
+
+    for(uint row = 0; gids != NULL && row < height; row++)
+    {
+        for(uint col = 0; col < width; col++)
+        {
+            uint32_t gid = gids[static_cast<size_t>(row) * width + col] & GID_MASK;
+            if(gid == 0)
+            {
+                continue;
+            }
+
+            uint8_t mask = gid < tile_masks.size() ? tile_masks[gid] : default_mask;
+            if(mask != 0)
+            {
+                setTile(col, row, mask);
+            }
+        }
+    }
+
+    for(uint region_y = 0; region_y < m_regions_y; region_y++)
+    {
+        for(uint region_x = 0; region_x < m_regions_x; region_x++)
+        {
+            meshRegion(region_x, region_y);
+        }
+    }
+    m_meshed = true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void CollisionMap::setTile(uint col, uint row, uint8_t mask)
+{
+    if(col * 2 >= m_width || row * 2 >= m_height)
+    {
+        return;
+    }
+
+    setBit(col * 2, row * 2, (mask & COLLISION_TOP_LEFT) != 0);
+    setBit(col * 2 + 1, row * 2, (mask & COLLISION_TOP_RIGHT) != 0);
+    setBit(col * 2, row * 2 + 1, (mask & COLLISION_BOTTOM_LEFT) != 0);
+    setBit(col * 2 + 1, row * 2 + 1, (mask & COLLISION_BOTTOM_RIGHT) != 0);
+
+    //a tile never straddles regions, both are even sized
+    if(m_meshed == true)
+    {
+        meshRegion(col * 2 / REGION_SIZE, row * 2 / REGION_SIZE);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool CollisionMap::overlaps(const SDL_Rect &area) const
+{
+    if(area.w <= 0 || area.h <= 0 || m_width == 0)
+    {
+        return false;
+    }
+
+    //quadrants are half a tile, 2 * x / tile_width keeps odd tile sizes exact
+    int first_x = std::max(0, floorDiv(area.x * 2, m_tile_width));
+    int first_y = std::max(0, floorDiv(area.y * 2, m_tile_height));
+    int last_x  = std::min(static_cast<int>(m_width) - 1,
+                           floorDiv((area.x + area.w - 1) * 2, m_tile_width));
+    int last_y  = std::min(static_cast<int>(m_height) - 1,
+                           floorDiv((area.y + area.h - 1) * 2, m_tile_height));
+
+    if(first_x > last_x || first_y > last_y)
+    {
+        return false;
+    }
+
+    //bits of the first and last word that lie inside the area
+    uint first_word = first_x / 64;
+    uint last_word = last_x / 64;
+    uint64_t first_mask = ~static_cast<uint64_t>(0) << (first_x % 64);
+    uint64_t last_mask = ~static_cast<uint64_t>(0) >> (63 - last_x % 64);
+
+    for(int y = first_y; y <= last_y; y++)
+    {
+        const uint64_t *row = &m_bits[y * m_words_per_row];
+
+        if(first_word == last_word)
+        {
+            if((row[first_word] & first_mask & last_mask) != 0)
+            {
+                return true;
+            }
+            continue;
+        }
+
+        if((row[first_word] & first_mask) != 0 || (row[last_word] & last_mask) != 0)
+        {
+            return true;
+        }
+        for(uint word = first_word + 1; word < last_word; word++)
+        {
+            if(row[word] != 0)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void CollisionMap::meshRegion(uint region_x, uint region_y)
+{
+    vector<SDL_Rect> &colliders = m_region_colliders[region_y * m_regions_x + region_x];
+    m_collider_count -= colliders.size();
+    colliders.clear();
+
+    uint first_y = region_y * REGION_SIZE;
+    uint rows = std::min(static_cast<uint>(REGION_SIZE), m_height - first_y);
+
+    //bits already part of a rectangle that started in an upper row
+    uint64_t covered[REGION_SIZE] = {0};
+
+    for(uint y = 0; y < rows; y++)
+    {
+        uint64_t open = m_bits[(first_y + y) * m_words_per_row + region_x] & ~covered[y];
+        while(open != 0)
+        {
+            //widest run starting at the lowest open bit
+            uint start = __builtin_ctzll(open);
+            uint64_t gaps = ~(open >> start);
+            uint length = gaps == 0 ? REGION_SIZE : __builtin_ctzll(gaps);
+            uint64_t run = (length == REGION_SIZE ? ~static_cast<uint64_t>(0) :
+                           (static_cast<uint64_t>(1) << length) - 1) << start;
+
+            //then grow down as long as the whole run stays solid
+            uint height = 1;
+            while(y + height < rows)
+            {
+                uint64_t below = m_bits[(first_y + y + height) * m_words_per_row + region_x] &
+                                 ~covered[y + height];
+                if((below & run) != run)
+                {
+                    break;
+                }
+                covered[y + height] |= run;
+                height++;
+            }
+            open &= ~run;
+
+            uint quadrant_x = region_x * REGION_SIZE + start;
+            uint quadrant_y = first_y + y;
+
+            SDL_Rect collider;
+            collider.x = toPixelX(quadrant_x);
+            collider.y = toPixelY(quadrant_y);
+            collider.w = toPixelX(quadrant_x + length) - collider.x;
+            collider.h = toPixelY(quadrant_y + height) - collider.y;
+            colliders.push_back(collider);
+        }
+    }
+
+    m_collider_count += colliders.size();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void CollisionMap::queryColliders(const SDL_Rect &area, vector<SDL_Rect> &result) const
+{
+    if(area.w <= 0 || area.h <= 0 || m_width == 0)
+    {
+        return;
+    }
+
+    //colliders never leave their region, only the overlapped ones are scanned
+    int region_w = REGION_SIZE * m_tile_width / 2;
+    int region_h = REGION_SIZE * m_tile_height / 2;
+    int first_x = std::max(0, floorDiv(area.x, region_w));
+    int first_y = std::max(0, floorDiv(area.y, region_h));
+    int last_x  = std::min(static_cast<int>(m_regions_x) - 1,
+                           floorDiv(area.x + area.w - 1, region_w));
+    int last_y  = std::min(static_cast<int>(m_regions_y) - 1,
+                           floorDiv(area.y + area.h - 1, region_h));
+
+    for(int region_y = first_y; region_y <= last_y; region_y++)
+    {
+        for(int region_x = first_x; region_x <= last_x; region_x++)
+        {
+            const vector<SDL_Rect> &colliders = m_region_colliders[region_y * m_regions_x + region_x];
+            for(uint i = 0; i < colliders.size(); i++)
+            {
+                const SDL_Rect &collider = colliders[i];
+                if(collider.x < area.x + area.w && area.x < collider.x + collider.w &&
+                   collider.y < area.y + area.h && area.y < collider.y + collider.h)
+                {
+                    result.push_back(collider);
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void CollisionMap::getColliders(vector<SDL_Rect> &result) const
+{
+    result.reserve(result.size() + m_collider_count);
+    for(uint i = 0; i < m_region_colliders.size(); i++)
+    {
+        result.insert(result.end(), m_region_colliders[i].begin(), m_region_colliders[i].end());
+    }
+}
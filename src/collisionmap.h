@@ -0,0 +1,150 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef COLLISIONMAP_H
+#define COLLISIONMAP_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <vector>
+
+#include "common.h"
+
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! quadrant bits of a tile, same order as the TMX terrain corners
+enum CollisionQuadrant
+{
+    COLLISION_TOP_LEFT      = 1,
+    COLLISION_TOP_RIGHT     = 2,
+    COLLISION_BOTTOM_LEFT   = 4,
+    COLLISION_BOTTOM_RIGHT  = 8,
+    COLLISION_FULL_TILE     = 15
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Solid parts of one tile layer as a packed bitmap, every tile covers
+//! 2x2 bits (one per quadrant). Area queries only look at the bits under
+//! the area, so they cost the same on any map size.
+//!
+//! For rectangle based tests the solid bits are also merged into static
+//! colliders: each region of 64x64 quadrants is greedily split into
+//! maximal rectangles, a changed tile only remeshes its own region.
+class CollisionMap
+{
+    public:
+        CollisionMap();
+
+        //! tile_masks[gid] is the CollisionQuadrant mask of gid, gids past
+        //! the end get default_mask (flip flags are ignored, 0 is empty)
+        void build(uint width, uint height, uint tile_width, uint tile_height,
+                   const uint32_t *gids, const vector<uint8_t> &tile_masks,
+                   uint8_t default_mask);
+
+        void setTile(uint col, uint row, uint8_t mask);
+
+        //! true if a solid quadrant overlaps area (map pixel coordinates)
+        bool overlaps(const SDL_Rect &area) const;
+
+        //! appends the static colliders overlapping area (map pixels)
+        void queryColliders(const SDL_Rect &area, vector<SDL_Rect> &result) const;
+
+        //! appends all static colliders
+        void getColliders(vector<SDL_Rect> &result) const;
+
+        inline uint getColliderCount() const
+        {
+            return m_collider_count;
+        }
+
+        inline bool isSolid(uint quadrant_x, uint quadrant_y) const
+        {
+            if(quadrant_x >= m_width || quadrant_y >= m_height)
+            {
+                return false;
+            }
+            return (m_bits[quadrant_y * m_words_per_row + quadrant_x / 64] >>
+                    (quadrant_x % 64)) & 1;
+        }
+
+        //! size in quadrants, twice the tile count of the layer
+        inline uint getWidth() const
+        {
+            return m_width;
+        }
+
+        inline uint getHeight() const
+        {
+            return m_height;
+        }
+
+    private:
+        //! greedy meshing of one region into m_region_colliders
+        void meshRegion(uint region_x, uint region_y);
+
+        //! left/top pixel of a quadrant column/row, exact for odd tile sizes
+        inline int toPixelX(uint quadrant_x) const
+        {
+            return (static_cast<int>(quadrant_x) * m_tile_width + 1) / 2;
+        }
+
+        inline int toPixelY(uint quadrant_y) const
+        {
+            return (static_cast<int>(quadrant_y) * m_tile_height + 1) / 2;
+        }
+
+        inline void setBit(uint quadrant_x, uint quadrant_y, bool solid)
+        {
+            uint64_t &word = m_bits[quadrant_y * m_words_per_row + quadrant_x / 64];
+            uint64_t bit = static_cast<uint64_t>(1) << (quadrant_x % 64);
+            word = solid == true ? (word | bit) : (word & ~bit);
+        }
+
+        uint m_width;
+        uint m_height;
+        uint m_words_per_row;
+        int m_tile_width;
+        int m_tile_height;
+
+        vector<uint64_t> m_bits;
+
+        //! quadrants per region side, one bitmap word per region row
+        static const uint REGION_SIZE = 64;
+
+        uint m_regions_x;
+        uint m_regions_y;
+        //! false while build() fills the bitmap, meshing happens once at the end
+        bool m_meshed;
+        uint m_collider_count;
+        vector<vector<SDL_Rect> > m_region_colliders;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -29,6 +29,8 @@
 
 #include <iostream>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <time.h>
 #include <assert.h>
 
@@ -44,6 +46,18 @@ typedef unsigned long ulong;
 #define DATETIME
 
 #define UNUSED(x) (void)(x)
+
+//! FNV-1a, start with FNV_OFFSET_BASIS and chain the calls
+static const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+inline uint32_t hashBytes(uint32_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for(size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
 #define DISABLECOPY(classname)  private: \
                                  classname(const classname &rhs); \
                                  classname operator=(const classname &rhs)
@@ -32,7 +32,9 @@
 #include "common.h"
 #include "errorcodes.h"
 
+#include "entitytable.h"
 #include "logging.h"
+#include "metrics.h"
 
 using std::shared_ptr;
 
@@ -52,18 +54,34 @@ class GameCore
             return *m_default_logger;
         }
 
+        MetricsRegistry& metrics()
+        {
+            return *m_metrics;
+        }
+
+        EntityTable& entities()
+        {
+            return *m_entities;
+        }
+
     private:
         GameCore()
         {
             m_default_logger = new Logger(LOG_INFO);
             assert(m_default_logger);
+            m_metrics = new MetricsRegistry();
+            m_entities = new EntityTable();
         };
         ~GameCore()
         {
+            delete m_entities;
+            delete m_metrics;
             delete m_default_logger;
         };
 
         Logger *m_default_logger;
+        MetricsRegistry *m_metrics;
+        EntityTable *m_entities;
 
         DISABLECOPY(GameCore);
 
@@ -73,6 +91,28 @@ class GameCore
 
 #define Logger GameCore::instance().logger()
 
+//! use this instead of Logger.logMessage: statements filtered at compile
+//! time vanish, runtime filtered ones skip evaluating their arguments.
+//! The format has to be a string literal, binary logs keep the pointer.
+#define LOGMESSAGE(level, category, ...) \
+    do \
+    { \
+        if(LOG_COMPILED_IN(level, category) && \
+           Logger.isEnabled(level, category) == true) \
+        { \
+            if((level) != LOG_FATAL && Logger.isBinary() == true) \
+            { \
+                static std::atomic<uint32_t> log_format_id(0); \
+                Logger.logBinary(&log_format_id, level, category, \
+                                 __FILE__, __LINE__, __VA_ARGS__); \
+            } \
+            else \
+            { \
+                Logger.logMessage(level, category, __VA_ARGS__); \
+            } \
+        } \
+    } while(0)
+
 ///////////////////////////////////////////////////////////////////////////
 
 #endif
@@ -0,0 +1,147 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "entitytable.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+EntityTable::EntityTable() :
+    m_free_list(NO_SLOT),
+    m_count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+EntityHandle EntityTable::create(GameObject *object)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t index = m_free_list;
+    if(index != NO_SLOT)
+    {
+        m_free_list = m_slots[index].next_free;
+    }
+    else
+    {
+        if(m_slots.size() >= NO_SLOT)
+        {
+            return EntityHandle();
+        }
+
+        index = m_slots.size();
+        Slot slot;
+        slot.object = NULL;
+        slot.generation = 0;
+        slot.next_free = NO_SLOT;
+        m_slots.push_back(slot);
+    }
+
+    //generation 0 is skipped, handle 0 stays the null handle
+    Slot &slot = m_slots[index];
+    slot.generation = (slot.generation + 1) & GENERATION_MASK;
+    if(slot.generation == 0)
+    {
+        slot.generation = 1;
+    }
+    slot.object = object;
+    slot.next_free = NO_SLOT;
+    m_count++;
+
+    EntityHandle handle;
+    handle.value = (slot.generation << INDEX_BITS) | index;
+    return handle;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void EntityTable::destroy(EntityHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t index = findSlot(handle);
+    if(index == NO_SLOT)
+    {
+        return;
+    }
+
+    //the generation stays, it is bumped when the slot is reused
+    Slot &slot = m_slots[index];
+    slot.object = NULL;
+    slot.next_free = m_free_list;
+    m_free_list = index;
+    m_count--;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+GameObject* EntityTable::get(EntityHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t index = findSlot(handle);
+    if(index == NO_SLOT)
+    {
+        return NULL;
+    }
+    return m_slots[index].object;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint EntityTable::getCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+const string& EntityTable::intern(const string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return *(m_names.insert(name).first);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint32_t EntityTable::findSlot(EntityHandle handle) const
+{
+    uint32_t index = handle.value & INDEX_MASK;
+    if(handle.isNull() == true || index >= m_slots.size())
+    {
+        return NO_SLOT;
+    }
+
+    const Slot &slot = m_slots[index];
+    if(slot.object == NULL || slot.generation != (handle.value >> INDEX_BITS))
+    {
+        return NO_SLOT;
+    }
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////
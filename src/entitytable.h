@@ -0,0 +1,130 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef ENTITYTABLE_H
+#define ENTITYTABLE_H
+
+#include <stdint.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+using std::set;
+using std::string;
+using std::vector;
+
+class GameObject;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Generational reference to a GameObject: slot index in the low bits,
+//! generation of the slot above. A slot reused for another object gets a
+//! new generation, so handles of destroyed objects never resolve to it.
+struct EntityHandle
+{
+    EntityHandle() :
+        value(0)
+    {
+    }
+
+    //0 is never handed out
+    uint32_t value;
+
+    inline bool operator==(const EntityHandle &rhs) const
+    {
+        return value == rhs.value;
+    }
+
+    inline bool operator!=(const EntityHandle &rhs) const
+    {
+        return value != rhs.value;
+    }
+
+    inline bool isNull() const
+    {
+        return value == 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Handle -> object table of all live GameObjects (see GameCore::entities)
+//! and the pool of interned object names. Objects are created and
+//! destroyed on the render thread too, all calls take the table lock.
+//! Compare handles (or pointers) in hot loops instead of looking up.
+class EntityTable
+{
+    DISABLECOPY(EntityTable);
+
+    public:
+        EntityTable();
+
+        //! null handle if all slots are taken
+        EntityHandle create(GameObject *object);
+        void destroy(EntityHandle handle);
+
+        //! NULL once the object of handle was destroyed
+        GameObject* get(EntityHandle handle) const;
+
+        uint getCount() const;
+
+        //! the same string for equal names, valid until the table is gone
+        const string& intern(const string &name);
+
+    private:
+        struct Slot
+        {
+            GameObject *object;
+            uint32_t generation;
+            //next free slot while the slot is unused
+            uint32_t next_free;
+        };
+
+        static const uint32_t INDEX_BITS = 20;
+        static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+        //! end of the free list, also the slot count limit
+        static const uint32_t NO_SLOT = INDEX_MASK;
+
+        //! slot of handle if handle is current, NO_SLOT otherwise
+        uint32_t findSlot(EntityHandle handle) const;
+
+        vector<Slot>    m_slots;
+        uint32_t        m_free_list;
+        uint            m_count;
+
+        //set nodes do not move, interned names stay valid
+        set<string>     m_names;
+
+        mutable std::mutex m_mutex;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -37,6 +37,7 @@ enum ErrorCode : unsigned int
     ERROR_FILE_NOT_FOUND    = 3,
     ERROR_OPENING_FILE      = 4,
     ERROR_SDL_INIT          = 5,
+    ERROR_INVALID_DATA      = 6,
     NB_ERROR_COUNTER
 };
 
@@ -58,7 +59,10 @@ static const string error_msgs[NB_ERROR_COUNTER] =
     "Unable to open file",
 
     /* ERROR_SDL_INIT */
-    "Error while initializing SDL"
+    "Error while initializing SDL",
+
+    /* ERROR_INVALID_DATA */
+    "Invalid or corrupt data"
 };
 
 #define ERRORMSG(type) error_msgs[type]
@@ -0,0 +1,84 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "fixedtimestep.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+FixedTimestep::FixedTimestep(uint ticks_per_second, uint max_ticks_per_frame) :
+    m_ticks_per_second(ticks_per_second),
+    m_max_ticks_per_frame(max_ticks_per_frame),
+    m_frequency(SDL_GetPerformanceFrequency()),
+    m_last_counter(SDL_GetPerformanceCounter()),
+    m_accumulator(0),
+    m_tick_count(0),
+    m_dropped_ticks(0)
+{
+    assert(ticks_per_second > 0);
+    assert(max_ticks_per_frame > 0);
+
+    m_tick_length = m_frequency / ticks_per_second;
+    if(m_tick_length == 0)
+    {
+        m_tick_length = 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint FixedTimestep::advance()
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    m_accumulator += now - m_last_counter;
+    m_last_counter = now;
+
+    uint64_t ticks = m_accumulator / m_tick_length;
+    m_accumulator -= ticks * m_tick_length;
+
+    if(ticks > m_max_ticks_per_frame)
+    {
+        m_dropped_ticks += ticks - m_max_ticks_per_frame;
+        ticks = m_max_ticks_per_frame;
+    }
+
+    m_tick_count += ticks;
+    return static_cast<uint>(ticks);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint FixedTimestep::getMsUntilNextTick() const
+{
+    uint64_t elapsed = m_accumulator + (SDL_GetPerformanceCounter() - m_last_counter);
+    if(elapsed >= m_tick_length)
+    {
+        return 0;
+    }
+
+    return static_cast<uint>((m_tick_length - elapsed) * 1000 / m_frequency);
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,94 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef FIXEDTIMESTEP_H
+#define FIXEDTIMESTEP_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+#include "common.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Fixed timestep accumulator on the performance counter
+//!
+//! Real time is accumulated in counter units (no float drift) and paid
+//! out in whole ticks. Catching up is capped, time beyond the cap is
+//! dropped so a slow frame can't trigger ever longer frames.
+class FixedTimestep
+{
+    DISABLECOPY(FixedTimestep);
+
+    public:
+        FixedTimestep(uint ticks_per_second, uint max_ticks_per_frame);
+
+        //! adds the time since the last call, returns the ticks to run
+        uint advance();
+
+        //! fraction of a tick accumulated but not simulated yet (0.0 - 1.0),
+        //! used to interpolate between the last two simulated states
+        inline float getAlpha() const
+        {
+            return static_cast<float>(m_accumulator) / static_cast<float>(m_tick_length);
+        }
+
+        //! milliseconds until the next tick is due
+        uint getMsUntilNextTick() const;
+
+        inline uint getTicksPerSecond() const
+        {
+            return m_ticks_per_second;
+        }
+
+        inline uint64_t getTickCount() const
+        {
+            return m_tick_count;
+        }
+
+        //! ticks skipped because of the catch-up cap
+        inline uint64_t getDroppedTicks() const
+        {
+            return m_dropped_ticks;
+        }
+
+    private:
+        uint m_ticks_per_second;
+        uint m_max_ticks_per_frame;
+
+        //performance counter units
+        uint64_t m_frequency;
+        uint64_t m_tick_length;
+        uint64_t m_last_counter;
+        uint64_t m_accumulator;
+
+        uint64_t m_tick_count;
+        uint64_t m_dropped_ticks;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
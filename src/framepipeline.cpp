@@ -0,0 +1,76 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "framepipeline.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+FramePipeline::FramePipeline() :
+    m_back(0),
+    m_front(1),
+    m_ready(2),
+    m_next_frame(0)
+{
+    for(uint i = 0; i < 3; i++)
+    {
+        m_frame_numbers[i] = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+RenderQueue& FramePipeline::beginFrame()
+{
+    m_buffers[m_back].clear();
+    return m_buffers[m_back];
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void FramePipeline::publishFrame()
+{
+    m_frame_numbers[m_back] = m_next_frame.fetch_add(1);
+
+    //release: the recorded commands are visible to whoever gets the index
+    uint previous = m_ready.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel);
+    m_back = previous & ~FRESH_BIT;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+RenderQueue* FramePipeline::acquireFrame()
+{
+    if((m_ready.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+    {
+        return NULL;
+    }
+
+    uint previous = m_ready.exchange(m_front, std::memory_order_acq_rel);
+    m_front = previous & ~FRESH_BIT;
+    return &m_buffers[m_front];
+}
+
+///////////////////////////////////////////////////////////////////////////
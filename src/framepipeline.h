@@ -0,0 +1,87 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "common.h"
+#include "renderqueue.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Triple buffered frame snapshots between simulation and render thread
+//!
+//! The simulation records into the back buffer and publishes it, the
+//! render thread picks up the newest published frame. Neither side ever
+//! waits for the other, frames the renderer did not get to are dropped.
+class FramePipeline
+{
+    DISABLECOPY(FramePipeline);
+
+    public:
+        FramePipeline();
+
+        //! simulation thread: empty queue to record the next frame into
+        RenderQueue& beginFrame();
+
+        //! simulation thread: hands the recorded frame to the renderer
+        void publishFrame();
+
+        //! render thread: newest published frame, NULL if there is none
+        //! since the last call; valid until the next acquireFrame
+        RenderQueue* acquireFrame();
+
+        //! render thread: number of the frame returned by acquireFrame
+        inline uint64_t getAcquiredFrameNumber() const
+        {
+            return m_frame_numbers[m_front];
+        }
+
+        //! number the next published frame will get (0 based)
+        inline uint64_t getNextFrameNumber() const
+        {
+            return m_next_frame.load();
+        }
+
+    private:
+        //m_ready holds the buffer index, this bit marks an unread frame
+        static const uint FRESH_BIT = 4;
+
+        RenderQueue m_buffers[3];
+        uint64_t m_frame_numbers[3];
+
+        uint m_back;
+        uint m_front;
+        std::atomic<uint> m_ready;
+        std::atomic<uint64_t> m_next_frame;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -25,14 +25,25 @@
  *-----------------------------------------------------------------------*/
 
 #include "gameobject.h"
+#include "trace.h"
 
 ///////////////////////////////////////////////////////////////////////////
 
-GameObject::GameObject(const string &id,
+GameObject::GameObject(const string &name,
                        const bool &collision) :
-    m_id(id),
-    m_collision(collision)
+    m_handle(GameCore::instance().entities().create(this)),
+    m_name(&GameCore::instance().entities().intern(name)),
+    m_broadphase(NULL),
+    m_collision(collision),
+    m_render_layer(RENDER_LAYER_OBJECTS),
+    m_draw_order(DRAWORDER_TOPDOWN)
 {
+    //operator== compares handles, two null handles would be equal
+    if(m_handle.isNull() == true)
+    {
+        LOGMESSAGE(LOG_FATAL, LOG_CORE, "GameObject::GameObject: "
+                          "No entity slot left for %s\n", name.c_str());
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -44,11 +55,13 @@ void GameObject::update()
 
 ///////////////////////////////////////////////////////////////////////////
 
-void GameObject::drawAll()
+void GameObject::drawAll(float alpha)
 {
+    UNUSED(alpha);
+
     for(uint i = 0; i < m_graphics_objects.size(); i++)
     {
-        m_graphics_objects.at(i).get()->drawObject();
+        m_graphics_objects.at(i).get()->drawObject(m_render_layer, m_draw_order);
     }
 }
 
@@ -56,7 +69,32 @@ void GameObject::drawAll()
 
 void GameObject::addGraphicsObject(shared_ptr<GraphicsObject> obj)
 {
+    obj.get()->setOwner(this);
     m_graphics_objects.push_back(obj);
+
+    if(m_broadphase != NULL)
+    {
+        m_broadphase->insert(obj.get());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GameObject::setBroadphase(AABBTree *tree)
+{
+    for(uint i = 0; i < m_graphics_objects.size(); i++)
+    {
+        if(m_broadphase != NULL)
+        {
+            m_broadphase->remove(m_graphics_objects.at(i).get());
+        }
+        if(tree != NULL)
+        {
+            tree->insert(m_graphics_objects.at(i).get());
+        }
+    }
+
+    m_broadphase = tree;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -70,36 +108,75 @@ bool GameObject::handleKeyEvent(const InputEvent &event)
 
 GameObject::~GameObject()
 {
-    //TODO
+    //graphics objects are shared, they must not point to us anymore
+    setBroadphase(NULL);
+    for(uint i = 0; i < m_graphics_objects.size(); i++)
+    {
+        m_graphics_objects.at(i).get()->setOwner(NULL);
+    }
+
+    //stale handles resolve to NULL from now on
+    GameCore::instance().entities().destroy(m_handle);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 bool GameObject::checkCollision(const GameObject &other) const
 {
-    Logger.logMessage(LOG_STATE, LOG_CORE, "GameObject::checkCollision: start\n");
+    LOGMESSAGE(LOG_STATE, LOG_CORE, "GameObject::checkCollision: start\n");
+    TRACE_ZONE("GameObject::checkCollision");
 
     if(this->hasCollisionEnabled() == false ||
        other.hasCollisionEnabled() == false)
     {
-        Logger.logMessage(LOG_DEBUG2, LOG_CORE, "GameObject::checkCollision: Collision detection not enabled for both elements\n");
+        LOGMESSAGE(LOG_DEBUG2, LOG_CORE, "GameObject::checkCollision: Collision detection not enabled for both elements\n");
         return false;
     }
 
-    const vector<shared_ptr <GraphicsObject> > other_objects = other.getGraphicsObjects();
+    static MetricCounter &pair_tests = GameCore::instance().metrics().counter("collision_pair_tests");
+
+    //counted locally, one atomic add per call
+    uint tests = 0;
+
+    const vector<shared_ptr <GraphicsObject> > &other_objects = other.getGraphicsObjects();
     for(uint i = 0; i < m_graphics_objects.size(); i++)
     {
         for(uint j = 0; j < other_objects.size(); j++)
         {
+            tests++;
             if(m_graphics_objects.at(i).get()->hasCollision(*(other_objects.at(j).get())))
             {
+                pair_tests.add(tests);
                 return true;
             }
         }
     }
 
-    Logger.logMessage(LOG_STATE, LOG_CORE, "GameObject::checkCollision: end\n");
+    pair_tests.add(tests);
+    LOGMESSAGE(LOG_STATE, LOG_CORE, "GameObject::checkCollision: end\n");
     return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////
+
+uint32_t GameObject::hashState(uint32_t hash) const
+{
+    for(uint i = 0; i < m_graphics_objects.size(); i++)
+    {
+        const SDL_Rect *dst = m_graphics_objects.at(i).get()->getDst().get();
+        if(dst == NULL)
+        {
+            continue;
+        }
+
+        //field by field, the struct may have padding
+        hash = hashBytes(hash, &dst->x, sizeof(dst->x));
+        hash = hashBytes(hash, &dst->y, sizeof(dst->y));
+        hash = hashBytes(hash, &dst->w, sizeof(dst->w));
+        hash = hashBytes(hash, &dst->h, sizeof(dst->h));
+    }
+
+    return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -43,12 +43,24 @@ class GameObject
     DISABLECOPY(GameObject);
 
     public:
-        GameObject(const string &id, const bool &collision = true);
+        //! name is only for debugging, it does not have to be unique
+        GameObject(const string &name, const bool &collision = true);
         virtual ~GameObject();
 
         inline bool operator==(const GameObject &rhs) const
         {
-            return m_id == rhs.getId();
+            return m_handle == rhs.m_handle;
+        }
+
+        //! resolves through GameCore::instance().entities() while we live
+        inline EntityHandle getHandle() const
+        {
+            return m_handle;
+        }
+
+        inline const string& getName() const
+        {
+            return *m_name;
         }
 
         inline const vector<shared_ptr <GraphicsObject> >& getGraphicsObjects() const
@@ -61,26 +73,71 @@ class GameObject
             return m_collision;
         }
 
-        inline const string getId() const
-        {
-            return m_id;
-        }
-
         virtual void update();
-        virtual void drawAll();
+        //! alpha: fraction of the next tick already elapsed (0.0 - 1.0),
+        //! moving objects interpolate their last two positions with it
+        virtual void drawAll(float alpha);
         virtual bool handleKeyEvent(const InputEvent &event);
         void addGraphicsObject(shared_ptr<GraphicsObject> obj);
 
+        //! layer and ordering the graphics objects are recorded with
+        inline void setRenderLayer(uint8_t layer, DrawOrder order)
+        {
+            m_render_layer = layer;
+            m_draw_order = order;
+        }
+
+        inline uint8_t getRenderLayer() const
+        {
+            return m_render_layer;
+        }
+
+        //! registers all graphics objects (current and future) in tree
+        virtual void setBroadphase(AABBTree *tree);
+
         virtual bool checkCollision(const GameObject &other) const;
 
+        //! folds the simulated state into hash (see hashBytes), replays
+        //! compare these per tick to find where they diverged
+        virtual uint32_t hashState(uint32_t hash) const;
+
+        //! objects that do not put their collision shapes into the
+        //! broadphase (e.g. the culled tile map) answer area queries here
+        virtual bool usesAreaCollision() const
+        {
+            return false;
+        }
+
+        virtual bool checkAreaCollision(const SDL_Rect &area) const
+        {
+            UNUSED(area);
+            return false;
+        }
+
+        //! appends the solid rects overlapping area, same coordinates as
+        //! checkAreaCollision (used to sweep moving objects)
+        virtual void queryAreaColliders(const SDL_Rect &area, vector<SDL_Rect> &result) const
+        {
+            UNUSED(area);
+            UNUSED(result);
+        }
+
     protected:
         //TODO: create vector<int> m_draw_objects_at?
         vector<shared_ptr <GraphicsObject> > m_graphics_objects;
 
-        string m_id;
+        EntityHandle m_handle;
+        //interned, see EntityTable::intern
+        const string *m_name;
+
+        //broadphase the graphics objects are registered in (may be NULL)
+        AABBTree *m_broadphase;
 
         //TODO: move to graphics object?
         bool m_collision;
+
+        uint8_t m_render_layer;
+        DrawOrder m_draw_order;
 };
 
 ///////////////////////////////////////////////////////////////////////////
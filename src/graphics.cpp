@@ -25,13 +25,27 @@
  *-----------------------------------------------------------------------*/
 
 #include "graphics.h"
+#include "trace.h"
 
 ///////////////////////////////////////////////////////////////////////////
 
 GraphicsCore::GraphicsCore() :
+    m_display_mode(DISPLAY_WINDOW),
     m_main_window(NULL),
-    m_renderer(NULL)
+    m_renderer(NULL),
+    m_offscreen_surface(NULL),
+    m_record_queue(&m_render_queue),
+    m_batch_texture(NULL),
+    m_batch_texture_w(1.0f),
+    m_batch_texture_h(1.0f),
+    m_draw_calls(0),
+    m_last_draw_calls(0),
+    m_texture_switches(0),
+    m_bound_texture(NULL)
 {
+    //a screen full of 32px tiles
+    m_batch_vertices.reserve(4 * 512);
+    m_batch_indices.reserve(6 * 512);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -46,32 +60,59 @@ GraphicsCore::~GraphicsCore()
 
 ///////////////////////////////////////////////////////////////////////////
 
-ErrorCode GraphicsCore::initializeWindow()
+ErrorCode GraphicsCore::initializeWindow(DisplayMode mode)
 {
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::initializeWindow start\n");
 
     assert(m_main_window == NULL);
+    assert(m_offscreen_surface == NULL);
+
+    m_display_mode = mode;
+
+    if(mode != DISPLAY_WINDOW)
+    {
+        //no video subsystem, it would want a display
+        if(SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0)
+        {
+            LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
+                              "GraphicsCore::initializeWindow: %s", SDLERROR());
+            return ERROR_SDL_INIT;
+        }
+
+        m_offscreen_surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT,
+                                                             32, SDL_PIXELFORMAT_RGBA8888);
+        if(m_offscreen_surface == NULL)
+        {
+            LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
+                              "GraphicsCore::initializeWindow: %s", SDLERROR());
+            return ERROR_SDL_INIT;
+        }
+
+        LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
+                         "GraphicsCore::initializeWindow end\n");
+        return OK;
+    }
 
     //TODO: move SDL_INIT_EVERYTHING somewhere else
     if(SDL_Init(SDL_INIT_EVERYTHING) != 0)
     {
-        Logger.logMessage(LOG_ERROR, LOG_SDL2_GRAPHICS,
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
                           "GraphicsCore::initializeWindow: %s", SDLERROR());
         return ERROR_SDL_INIT;
     }
 
-    m_main_window = SDL_CreateWindow("TEST", 100, 100, 640, 480,
+    m_main_window = SDL_CreateWindow("TEST", 100, 100, SCREEN_WIDTH, SCREEN_HEIGHT,
                                      SDL_WINDOW_SHOWN);
 
     if(m_main_window == nullptr)
     {
-        Logger.logMessage(LOG_ERROR, LOG_SDL2_GRAPHICS,
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
                           "GraphicsCore::initializeWindow: %s", SDLERROR());
         return ERROR_SDL_INIT;
     }
 
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::initializeWindow end\n");
     return OK;
 }
@@ -80,23 +121,31 @@ ErrorCode GraphicsCore::initializeWindow()
 
 ErrorCode GraphicsCore::initializeRenderer()
 {
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::initializeRenderer start\n");
 
     assert(m_renderer == NULL);
 
-    m_renderer = SDL_CreateRenderer(m_main_window, -1,
-                                    SDL_RENDERER_ACCELERATED |
-                                    SDL_RENDERER_PRESENTVSYNC);
+    if(m_display_mode != DISPLAY_WINDOW)
+    {
+        m_renderer = SDL_CreateSoftwareRenderer(m_offscreen_surface);
+    }
+    else
+    {
+        m_renderer = SDL_CreateRenderer(m_main_window, -1,
+                                        SDL_RENDERER_ACCELERATED |
+                                        SDL_RENDERER_PRESENTVSYNC |
+                                        SDL_RENDERER_TARGETTEXTURE);
+    }
 
     if(m_renderer == nullptr)
     {
-        Logger.logMessage(LOG_ERROR, LOG_SDL2_GRAPHICS,
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
                           "GraphicsCore::initializeRenderer: %s", SDLERROR());
         return ERROR_SDL_INIT;
     }
 
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::initializeRenderer end\n");
     return OK;
 }
@@ -105,7 +154,7 @@ ErrorCode GraphicsCore::initializeRenderer()
 
 void GraphicsCore::destroyWindow()
 {
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::destroyWindow start\n");
 
     if(m_main_window != NULL)
@@ -113,7 +162,12 @@ void GraphicsCore::destroyWindow()
         SDL_DestroyWindow(m_main_window);
     }
 
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    if(m_offscreen_surface != NULL)
+    {
+        SDL_FreeSurface(m_offscreen_surface);
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::destroyWindow end\n");
 }
 
@@ -121,7 +175,7 @@ void GraphicsCore::destroyWindow()
 
 void GraphicsCore::destroyRenderer()
 {
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::destroyRenderer start\n");
 
     if(m_renderer != NULL)
@@ -129,7 +183,7 @@ void GraphicsCore::destroyRenderer()
         SDL_DestroyRenderer(m_renderer);
     }
 
-    Logger.logMessage(LOG_STATE, LOG_SDL2_GRAPHICS,
+    LOGMESSAGE(LOG_STATE, LOG_SDL2_GRAPHICS,
                      "GraphicsCore::destroyRenderer end\n");
 }
 
@@ -141,7 +195,7 @@ SDL_Texture* GraphicsCore::createTextureFromBMP(const string& filename)
 
     if(bmp == nullptr)
     {
-        Logger.logMessage(LOG_ERROR, LOG_SDL2_GRAPHICS,
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
                           "GraphicsCore::createTextureFromBMP: "
                           "Error loading file (%s)\n", SDLERROR());
         return NULL;
@@ -154,7 +208,7 @@ SDL_Texture* GraphicsCore::createTextureFromBMP(const string& filename)
 
     if(tex == nullptr)
     {
-        Logger.logMessage(LOG_ERROR, LOG_SDL2_GRAPHICS,
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
                           "GraphicsCore::createTextureFromBMP: "
                           "Error creating texture (%s)\n", SDLERROR());
         return NULL;
@@ -165,6 +219,57 @@ SDL_Texture* GraphicsCore::createTextureFromBMP(const string& filename)
 
 ///////////////////////////////////////////////////////////////////////////
 
+bool GraphicsCore::supportsRenderTargets()
+{
+    return m_renderer != NULL && SDL_RenderTargetSupported(m_renderer) == SDL_TRUE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+SDL_Texture* GraphicsCore::createRenderTarget(int w, int h)
+{
+    SDL_Texture *tex = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888,
+                                         SDL_TEXTUREACCESS_TARGET, w, h);
+
+    if(tex == nullptr)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
+                          "GraphicsCore::createRenderTarget: "
+                          "Error creating texture (%s)\n", SDLERROR());
+        return NULL;
+    }
+
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    return tex;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GraphicsCore::setRenderTarget(SDL_Texture *target)
+{
+    flushSprites();
+    if(SDL_SetRenderTarget(m_renderer, target) != 0)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
+                          "GraphicsCore::setRenderTarget: %s\n", SDLERROR());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GraphicsCore::clearRenderTarget()
+{
+    Uint8 r, g, b, a;
+    SDL_GetRenderDrawColor(m_renderer, &r, &g, &b, &a);
+
+    flushSprites();
+    SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 0);
+    SDL_RenderClear(m_renderer);
+    SDL_SetRenderDrawColor(m_renderer, r, g, b, a);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 void GraphicsCore::renderTextureClip(SDL_Texture *tex, int x, int y, SDL_Rect *clip)
 {
     assert(tex);
@@ -178,6 +283,8 @@ void GraphicsCore::renderTextureClip(SDL_Texture *tex, int x, int y, SDL_Rect *c
     dst.w   = clip->w;
     dst.h   = clip->h;
 
+    flushSprites();
+    countDrawCall(tex);
     SDL_RenderCopy(m_renderer, tex, clip, &dst);
 }
 
@@ -189,6 +296,8 @@ void GraphicsCore::renderTextureClip(SDL_Texture *tex, SDL_Rect *clip, SDL_Rect
     assert(clip);
     assert(dst);
 
+    flushSprites();
+    countDrawCall(tex);
     SDL_RenderCopy(m_renderer, tex, clip, dst);
 }
 
@@ -196,6 +305,7 @@ void GraphicsCore::renderTextureClip(SDL_Texture *tex, SDL_Rect *clip, SDL_Rect
 
 void GraphicsCore::clearRenderer()
 {
+    flushSprites();
     SDL_RenderClear(m_renderer);
 }
 
@@ -203,7 +313,40 @@ void GraphicsCore::clearRenderer()
 
 void GraphicsCore::presentRenderer()
 {
+    TRACE_ZONE("GraphicsCore::presentRenderer");
+
+    m_render_queue.submit();
+    flushSprites();
     SDL_RenderPresent(m_renderer);
+
+    static MetricCounter &draw_calls = GameCore::instance().metrics().counter("draw_calls");
+    static MetricCounter &texture_switches = GameCore::instance().metrics().counter("texture_switches");
+    static MetricGauge &frame_draw_calls = GameCore::instance().metrics().gauge("frame_draw_calls");
+    static MetricGauge &frame_texture_switches = GameCore::instance().metrics().gauge("frame_texture_switches");
+    draw_calls.add(m_draw_calls);
+    texture_switches.add(m_texture_switches);
+    frame_draw_calls.set(m_draw_calls);
+    frame_texture_switches.set(m_texture_switches);
+
+    m_last_draw_calls = m_draw_calls;
+    m_draw_calls = 0;
+    m_texture_switches = 0;
+    m_bound_texture = NULL;
+    TRACE_COUNTER("draw calls", m_last_draw_calls);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GraphicsCore::getOutputSize(int *w, int *h)
+{
+    assert(w);
+    assert(h);
+
+    if(m_renderer == NULL || SDL_GetRendererOutputSize(m_renderer, w, h) != 0)
+    {
+        *w = 0;
+        *h = 0;
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -227,7 +370,7 @@ void GraphicsCore::renderTexture(SDL_Texture *tex, int x, int y,
     {
         if((h != 0) != (w != 0))
         {
-            Logger.logMessage(LOG_WARNING, LOG_SDL2_GRAPHICS,
+            LOGMESSAGE(LOG_WARNING, LOG_SDL2_GRAPHICS,
                               "GraphicsCore::renderTexture: "
                               "One of the texture scaling values has been "
                               "set to 0. Ignoring set values...\n");
@@ -235,6 +378,8 @@ void GraphicsCore::renderTexture(SDL_Texture *tex, int x, int y,
         SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
     }
 
+    flushSprites();
+    countDrawCall(tex);
     SDL_RenderCopy(m_renderer, tex, NULL, &dst);
 }
 
@@ -250,7 +395,98 @@ void GraphicsCore::renderTextureDstOnly(SDL_Texture *tex, SDL_Rect *dst)
         SDL_QueryTexture(tex, NULL, NULL, &(dst->w), &(dst->h));
     }
 
+    flushSprites();
+    countDrawCall(tex);
     SDL_RenderCopy(m_renderer, tex, NULL, dst);
 }
 
 ///////////////////////////////////////////////////////////////////////////
+
+void GraphicsCore::queueSprite(SDL_Texture *tex, const SDL_Rect *clip, const SDL_Rect &dst)
+{
+    assert(tex);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if(tex != m_batch_texture)
+    {
+        flushSprites();
+
+        int tex_w = 1, tex_h = 1;
+        SDL_QueryTexture(tex, NULL, NULL, &tex_w, &tex_h);
+        m_batch_texture = tex;
+        m_batch_texture_w = static_cast<float>(tex_w);
+        m_batch_texture_h = static_cast<float>(tex_h);
+    }
+
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    if(clip != NULL)
+    {
+        u0 = clip->x / m_batch_texture_w;
+        v0 = clip->y / m_batch_texture_h;
+        u1 = (clip->x + clip->w) / m_batch_texture_w;
+        v1 = (clip->y + clip->h) / m_batch_texture_h;
+    }
+
+    float x0 = static_cast<float>(dst.x);
+    float y0 = static_cast<float>(dst.y);
+    float x1 = static_cast<float>(dst.x + dst.w);
+    float y1 = static_cast<float>(dst.y + dst.h);
+
+    int first = m_batch_vertices.size();
+    SDL_Vertex vertex;
+    vertex.color.r = vertex.color.g = vertex.color.b = vertex.color.a = 255;
+
+    vertex.position.x = x0; vertex.position.y = y0;
+    vertex.tex_coord.x = u0; vertex.tex_coord.y = v0;
+    m_batch_vertices.push_back(vertex);
+
+    vertex.position.x = x1; vertex.position.y = y0;
+    vertex.tex_coord.x = u1; vertex.tex_coord.y = v0;
+    m_batch_vertices.push_back(vertex);
+
+    vertex.position.x = x1; vertex.position.y = y1;
+    vertex.tex_coord.x = u1; vertex.tex_coord.y = v1;
+    m_batch_vertices.push_back(vertex);
+
+    vertex.position.x = x0; vertex.position.y = y1;
+    vertex.tex_coord.x = u0; vertex.tex_coord.y = v1;
+    m_batch_vertices.push_back(vertex);
+
+    //two triangles: 0 1 2, 2 3 0
+    m_batch_indices.push_back(first);
+    m_batch_indices.push_back(first + 1);
+    m_batch_indices.push_back(first + 2);
+    m_batch_indices.push_back(first + 2);
+    m_batch_indices.push_back(first + 3);
+    m_batch_indices.push_back(first);
+#else
+    //no geometry API before SDL 2.0.18, draw right away
+    countDrawCall(tex);
+    SDL_RenderCopy(m_renderer, tex, clip, &dst);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GraphicsCore::flushSprites()
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    if(m_batch_indices.empty() == false)
+    {
+        countDrawCall(m_batch_texture);
+        if(SDL_RenderGeometry(m_renderer, m_batch_texture,
+                              m_batch_vertices.data(), m_batch_vertices.size(),
+                              m_batch_indices.data(), m_batch_indices.size()) != 0)
+        {
+            LOGMESSAGE(LOG_ERROR, LOG_SDL2_GRAPHICS,
+                              "GraphicsCore::flushSprites: %s\n", SDLERROR());
+        }
+    }
+
+    m_batch_vertices.clear();
+    m_batch_indices.clear();
+#endif
+    m_batch_texture = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////
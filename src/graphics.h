@@ -28,14 +28,32 @@
 #define GRAPHICS_H
 
 #include "core.h"
+#include "renderqueue.h"
 
 #include <SDL2/SDL.h>
+#include <vector>
+
+using std::vector;
 
 struct SDL_Window;
 struct SDL_Renderer;
 
 ///////////////////////////////////////////////////////////////////////////
 
+//! where frames go, the headless modes need no display or GPU
+enum DisplayMode
+{
+    //! accelerated, vsynced window
+    DISPLAY_WINDOW,
+    //! software renderer drawing into an SDL_Surface, no vsync
+    DISPLAY_OFFSCREEN,
+    //! simulation only: textures are still created (on the software
+    //! renderer) but nothing is ever drawn
+    DISPLAY_NONE
+};
+
+///////////////////////////////////////////////////////////////////////////
+
 class GraphicsCore
 {
     public:
@@ -55,12 +73,29 @@ class GraphicsCore
             return *m_renderer;
         }
 
-        ErrorCode initializeWindow();
+        ErrorCode initializeWindow(DisplayMode mode = DISPLAY_WINDOW);
         ErrorCode initializeRenderer();
+
+        inline DisplayMode getDisplayMode() const
+        {
+            return m_display_mode;
+        }
         void clearRenderer();
         void presentRenderer();
 
+        //! size of the area we render to, in pixels
+        void getOutputSize(int *w, int *h);
+
         SDL_Texture* createTextureFromBMP(const string& filename);
+
+        //! render target helpers, targets are transparent (blended)
+        bool supportsRenderTargets();
+        SDL_Texture* createRenderTarget(int w, int h);
+        //! NULL switches back to the window
+        void setRenderTarget(SDL_Texture *target);
+        //! clears the current target to fully transparent
+        void clearRenderTarget();
+
         void renderTexture(SDL_Texture *tex, int x, int y,
                            uint h = 0, uint w = 0);
         void renderTextureDstOnly(SDL_Texture *tex, SDL_Rect *dst);
@@ -68,6 +103,34 @@ class GraphicsCore
                                SDL_Rect *clip);
         void renderTextureClip(SDL_Texture *tex, SDL_Rect *clip, SDL_Rect *dst);
 
+        //! batched drawing: quads are collected per texture and submitted
+        //! with one SDL_RenderGeometry call, clip NULL means whole texture.
+        //! Draw order is kept, a texture change starts a new batch.
+        void queueSprite(SDL_Texture *tex, const SDL_Rect *clip, const SDL_Rect &dst);
+
+        //! submits the pending batch, done automatically before immediate
+        //! draws, target changes and present
+        void flushSprites();
+
+        //! queue drawAll records into, sorted and drawn on present
+        inline RenderQueue& getRenderQueue()
+        {
+            return *m_record_queue;
+        }
+
+        //! the pipelined loop records into frame snapshots instead,
+        //! NULL switches back to the queue submitted on present
+        inline void setRecordQueue(RenderQueue *queue)
+        {
+            m_record_queue = (queue != NULL) ? queue : &m_render_queue;
+        }
+
+        //! render submissions of the last presented frame
+        inline uint getDrawCallCount() const
+        {
+            return m_last_draw_calls;
+        }
+
     private:
         GraphicsCore();
         virtual ~GraphicsCore();
@@ -75,8 +138,40 @@ class GraphicsCore
         void destroyWindow();
         void destroyRenderer();
 
+        static const int SCREEN_WIDTH = 640;
+        static const int SCREEN_HEIGHT = 480;
+
+        DisplayMode     m_display_mode;
         SDL_Window      *m_main_window;
         SDL_Renderer    *m_renderer;
+        //! render target of the headless modes
+        SDL_Surface     *m_offscreen_surface;
+
+        RenderQueue         m_render_queue;
+        RenderQueue         *m_record_queue;
+
+        //pending batch, 4 vertices and 6 indices per quad
+        SDL_Texture         *m_batch_texture;
+        float               m_batch_texture_w;
+        float               m_batch_texture_h;
+        vector<SDL_Vertex>  m_batch_vertices;
+        vector<int>         m_batch_indices;
+
+        //! every submission to the renderer goes through here
+        inline void countDrawCall(SDL_Texture *tex)
+        {
+            m_draw_calls++;
+            if(tex != m_bound_texture)
+            {
+                m_texture_switches++;
+                m_bound_texture = tex;
+            }
+        }
+
+        uint m_draw_calls;
+        uint m_last_draw_calls;
+        uint m_texture_switches;
+        SDL_Texture *m_bound_texture;
 
         DISABLECOPY(GraphicsCore);
 };
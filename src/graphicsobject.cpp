@@ -31,7 +31,8 @@
 GraphicsObject::GraphicsObject(shared_ptr<SDL_Texture> texture,
                                int x, int y, uint h, uint w) :
                 m_texture(texture),
-                m_clip(NULL)
+                m_clip(NULL),
+                m_owner(NULL)
 {
     SDL_Rect *dst = new SDL_Rect();
     assert(dst);
@@ -39,6 +40,12 @@ GraphicsObject::GraphicsObject(shared_ptr<SDL_Texture> texture,
     dst->y = y;
     dst->h = h;
     dst->w = w;
+
+    //the real size is needed for the broadphase before the first draw
+    if((dst->h == 0 || dst->w == 0) && m_texture.get() != NULL)
+    {
+        SDL_QueryTexture(m_texture.get(), NULL, NULL, &(dst->w), &(dst->h));
+    }
     m_dst.reset(dst);
 }
 
@@ -48,7 +55,8 @@ GraphicsObject::GraphicsObject(shared_ptr<SDL_Texture> texture,
                                shared_ptr<SDL_Rect> clip,
                                shared_ptr<SDL_Rect> dst) :
                 m_texture(texture),
-                m_clip(clip), m_dst(dst)
+                m_clip(clip), m_dst(dst),
+                m_owner(NULL)
 {
 }
 
@@ -56,21 +64,30 @@ GraphicsObject::GraphicsObject(shared_ptr<SDL_Texture> texture,
 
 GraphicsObject::~GraphicsObject()
 {
-    //TODO: cleanup
+    if(m_tree_proxy.tree != NULL)
+    {
+        m_tree_proxy.tree->remove(this);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void GraphicsObject::drawObject()
+void GraphicsObject::drawObject(uint8_t layer, DrawOrder order)
 {
-    if(m_clip != NULL)
-    {
-        GraphicsCore::instance().renderTextureClip(m_texture.get(), m_clip.get(), m_dst.get());
-    }
-    else
-    {
-        GraphicsCore::instance().renderTextureDstOnly(m_texture.get(), m_dst.get());
-    }
+    GraphicsCore::instance().getRenderQueue().push(m_texture.get(), m_clip.get(),
+                                                   *(m_dst.get()), layer, order);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void GraphicsObject::drawObjectAt(int x, int y, uint8_t layer, DrawOrder order)
+{
+    SDL_Rect dst = *(m_dst.get());
+    dst.x = x;
+    dst.y = y;
+
+    GraphicsCore::instance().getRenderQueue().push(m_texture.get(), m_clip.get(),
+                                                   dst, layer, order);
 }
 
 ///////////////////////////////////////////////////////////////////////////
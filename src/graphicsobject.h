@@ -31,6 +31,9 @@
 
 #include "core.h"
 #include "graphics.h"
+#include "aabbtree.h"
+
+class GameObject;
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -45,16 +48,27 @@ class GraphicsObject
                        shared_ptr<SDL_Rect> clip,
                        shared_ptr<SDL_Rect> dst);
 
-        void drawObject();
+        //! records the object into the render queue of this frame
+        void drawObject(uint8_t layer, DrawOrder order);
+        //! same, but drawn at x/y instead of the current position
+        void drawObjectAt(int x, int y, uint8_t layer, DrawOrder order);
 
         inline void setX(int x)
         {
             m_dst.get()->x = x;
+            if(m_tree_proxy.tree != NULL)
+            {
+                m_tree_proxy.tree->update(this);
+            }
         }
 
         inline void setY(int y)
         {
             m_dst.get()->y = y;
+            if(m_tree_proxy.tree != NULL)
+            {
+                m_tree_proxy.tree->update(this);
+            }
         }
 
         inline int getX() const
@@ -82,6 +96,22 @@ class GraphicsObject
             return m_dst;
         }
 
+        //! the GameObject this belongs to (NULL if not attached)
+        inline GameObject* getOwner() const
+        {
+            return m_owner;
+        }
+
+        inline void setOwner(GameObject *owner)
+        {
+            m_owner = owner;
+        }
+
+        inline AABBTreeProxy& getTreeProxy()
+        {
+            return m_tree_proxy;
+        }
+
         bool hasCollision(const GraphicsObject &other);
 
         ~GraphicsObject();
@@ -91,6 +121,9 @@ class GraphicsObject
 
         shared_ptr<SDL_Rect>        m_clip;
         shared_ptr<SDL_Rect>        m_dst;
+
+        GameObject                  *m_owner;
+        AABBTreeProxy               m_tree_proxy;
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -36,6 +36,12 @@ enum InputEvent
     PLAYER_RIGHT,
     PLAYER_UP,
     PLAYER_DOWN,
+    PLAYER_LEFT_RELEASED,
+    PLAYER_RIGHT_RELEASED,
+    PLAYER_UP_RELEASED,
+    PLAYER_DOWN_RELEASED,
+    RENDER_TARGETS_RESET,
+    WRITE_TRACE,
     QUIT
 };
 
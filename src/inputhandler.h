@@ -52,7 +52,14 @@ class Inputhandler
                     return QUIT;
                 }
 
-                if(event.type == SDL_KEYDOWN)
+                //contents of render target textures are gone
+                if(event.type == SDL_RENDER_TARGETS_RESET)
+                {
+                    return RENDER_TARGETS_RESET;
+                }
+
+                //held keys are tracked by press/release, skip OS key repeat
+                if(event.type == SDL_KEYDOWN && event.key.repeat == 0)
                 {
                     switch(event.key.keysym.sym)
                     {
@@ -67,6 +74,27 @@ class Inputhandler
 
                         case SDLK_UP:
                             return PLAYER_UP;
+
+                        case SDLK_F12:
+                            return WRITE_TRACE;
+                    }
+                }
+
+                if(event.type == SDL_KEYUP)
+                {
+                    switch(event.key.keysym.sym)
+                    {
+                        case SDLK_LEFT:
+                            return PLAYER_LEFT_RELEASED;
+
+                        case SDLK_RIGHT:
+                            return PLAYER_RIGHT_RELEASED;
+
+                        case SDLK_DOWN:
+                            return PLAYER_DOWN_RELEASED;
+
+                        case SDLK_UP:
+                            return PLAYER_UP_RELEASED;
                     }
                 }
             }
@@ -0,0 +1,283 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <string.h>
+
+#include "inputjournal.h"
+#include "core.h"
+#include "mappedfile.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+InputJournal::InputJournal() :
+    m_file(NULL), m_last_tick(0),
+    m_replaying(false), m_next_event(0), m_next_checksum(0), m_end_tick(0),
+    m_mismatches(0), m_verified(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+InputJournal::~InputJournal()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode InputJournal::startRecording(const string &filename)
+{
+    close();
+
+    m_file = fopen(filename.c_str(), "wb");
+    if(m_file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    fwrite(INPUTJOURNAL_MAGIC, sizeof(INPUTJOURNAL_MAGIC), 1, m_file);
+    fwrite(&INPUTJOURNAL_VERSION, sizeof(INPUTJOURNAL_VERSION), 1, m_file);
+
+    m_last_tick = 0;
+    m_end_tick = 0;
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void InputJournal::writeRecord(InputJournalRecord type, uint64_t tick)
+{
+    fputc(type, m_file);
+
+    //ticks only go up, the distances mostly fit into one byte
+    uint64_t delta = tick - m_last_tick;
+    m_last_tick = tick;
+    do
+    {
+        uint8_t byte = delta & 0x7f;
+        delta >>= 7;
+        if(delta != 0)
+        {
+            byte |= 0x80;
+        }
+        fputc(byte, m_file);
+    }
+    while(delta != 0);
+
+    if(tick + 1 > m_end_tick)
+    {
+        m_end_tick = tick + 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void InputJournal::recordEvent(uint64_t tick, InputEvent event)
+{
+    if(m_file == NULL)
+    {
+        return;
+    }
+
+    writeRecord(JOURNAL_EVENT, tick);
+    fputc(static_cast<uint8_t>(event), m_file);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void InputJournal::recordChecksum(uint64_t tick, uint32_t checksum)
+{
+    if(m_file == NULL)
+    {
+        return;
+    }
+
+    writeRecord(JOURNAL_CHECKSUM, tick);
+    fwrite(&checksum, sizeof(checksum), 1, m_file);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode InputJournal::startReplay(const string &filename)
+{
+    close();
+
+    MappedFile file;
+    ErrorCode ret = file.open(filename);
+    if(ret != OK)
+    {
+        return ret;
+    }
+
+    const uint8_t *data = reinterpret_cast<const uint8_t*>(file.getData());
+    size_t size = file.getSize();
+    size_t header_size = sizeof(INPUTJOURNAL_MAGIC) + sizeof(INPUTJOURNAL_VERSION);
+
+    uint32_t version = 0;
+    if(size >= header_size)
+    {
+        memcpy(&version, data + sizeof(INPUTJOURNAL_MAGIC), sizeof(version));
+    }
+    if(size < header_size ||
+       memcmp(data, INPUTJOURNAL_MAGIC, sizeof(INPUTJOURNAL_MAGIC)) != 0 ||
+       version != INPUTJOURNAL_VERSION)
+    {
+        return ERROR_INVALID_DATA;
+    }
+
+    uint64_t tick = 0;
+    bool ended = false;
+    size_t position = header_size;
+
+    while(position < size && ended == false)
+    {
+        uint8_t type = data[position++];
+
+        uint64_t delta = 0;
+        uint shift = 0;
+        while(true)
+        {
+            if(position >= size || shift > 63)
+            {
+                return ERROR_INVALID_DATA;
+            }
+            uint8_t byte = data[position++];
+            delta |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+            if((byte & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        tick += delta;
+
+        switch(type)
+        {
+            case JOURNAL_EVENT:
+                if(position + 1 > size)
+                {
+                    return ERROR_INVALID_DATA;
+                }
+                m_events.push_back(std::make_pair(tick, static_cast<InputEvent>(data[position])));
+                position += 1;
+                break;
+
+            case JOURNAL_CHECKSUM:
+            {
+                uint32_t checksum;
+                if(position + sizeof(checksum) > size)
+                {
+                    return ERROR_INVALID_DATA;
+                }
+                memcpy(&checksum, data + position, sizeof(checksum));
+                m_checksums.push_back(std::make_pair(tick, checksum));
+                position += sizeof(checksum);
+                break;
+            }
+
+            case JOURNAL_END:
+                m_end_tick = tick;
+                ended = true;
+                break;
+
+            default:
+                return ERROR_INVALID_DATA;
+        }
+    }
+
+    //cut off recordings (crashes) replay as far as they go
+    if(ended == false)
+    {
+        LOGMESSAGE(LOG_WARNING, LOG_CORE, "InputJournal::startReplay: "
+                   "%s has no end record, replaying %llu ticks\n", filename.c_str(),
+                   static_cast<unsigned long long>(tick + 1));
+        m_end_tick = tick + 1;
+    }
+
+    m_replaying = true;
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void InputJournal::close()
+{
+    if(m_file != NULL)
+    {
+        writeRecord(JOURNAL_END, m_end_tick);
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    m_replaying = false;
+    m_events.clear();
+    m_next_event = 0;
+    m_checksums.clear();
+    m_next_checksum = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+InputEvent InputJournal::nextEvent(uint64_t tick)
+{
+    if(m_next_event < m_events.size() && m_events[m_next_event].first <= tick)
+    {
+        return m_events[m_next_event++].second;
+    }
+    return NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool InputJournal::verifyChecksum(uint64_t tick, uint32_t checksum)
+{
+    //skip ticks the recording has no checksum for
+    while(m_next_checksum < m_checksums.size() && m_checksums[m_next_checksum].first < tick)
+    {
+        m_next_checksum++;
+    }
+
+    if(m_next_checksum >= m_checksums.size() || m_checksums[m_next_checksum].first != tick)
+    {
+        return true;
+    }
+
+    uint32_t recorded = m_checksums[m_next_checksum++].second;
+    m_verified++;
+    if(recorded == checksum)
+    {
+        return true;
+    }
+
+    if(m_mismatches == 0)
+    {
+        LOGMESSAGE(LOG_WARNING, LOG_CORE, "InputJournal::verifyChecksum: "
+                   "replay diverged at tick %llu (%08x, recorded %08x)\n",
+                   static_cast<unsigned long long>(tick), checksum, recorded);
+    }
+    m_mismatches++;
+    return false;
+}
@@ -0,0 +1,141 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef INPUTJOURNAL_H
+#define INPUTJOURNAL_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "errorcodes.h"
+#include "inputevents.h"
+
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+//
+// Input journal format (.ijr)
+//
+// "SOAI", uint32_t version, then records. Each starts with a uint8_t
+// InputJournalRecord followed by the tick distance to the record before
+// as an unsigned LEB128 varint:
+//
+//  JOURNAL_EVENT       uint8_t InputEvent, delivered before the tick runs
+//  JOURNAL_CHECKSUM    uint32_t Objecthandler::getStateChecksum after it
+//  JOURNAL_END         nothing, its tick is the number of ticks recorded
+//
+///////////////////////////////////////////////////////////////////////////
+
+static const char       INPUTJOURNAL_MAGIC[4]   = { 'S', 'O', 'A', 'I' };
+static const uint32_t   INPUTJOURNAL_VERSION    = 1;
+
+enum InputJournalRecord
+{
+    JOURNAL_EVENT       = 1,
+    JOURNAL_CHECKSUM    = 2,
+    JOURNAL_END         = 3
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Records the input of a run with the simulation tick it was handled
+//! at, or plays one back and verifies the state checksum of every tick
+class InputJournal
+{
+    DISABLECOPY(InputJournal);
+
+    public:
+        InputJournal();
+        ~InputJournal();
+
+        ErrorCode startRecording(const string &filename);
+        //! reads the whole journal, fails on damaged files
+        ErrorCode startReplay(const string &filename);
+        //! finishes a recording, ends a replay
+        void close();
+
+        inline bool isRecording() const
+        {
+            return m_file != NULL;
+        }
+
+        inline bool isReplaying() const
+        {
+            return m_replaying;
+        }
+
+        void recordEvent(uint64_t tick, InputEvent event);
+        void recordChecksum(uint64_t tick, uint32_t checksum);
+
+        //! next recorded event for tick, NONE once there are no more
+        InputEvent nextEvent(uint64_t tick);
+
+        //! false if checksum differs from the recorded one, the first
+        //! divergence is logged
+        bool verifyChecksum(uint64_t tick, uint32_t checksum);
+
+        //! ticks in the recording, a replay is done after that many
+        inline uint64_t getTickCount() const
+        {
+            return m_end_tick;
+        }
+
+        inline uint64_t getMismatchCount() const
+        {
+            return m_mismatches;
+        }
+
+        inline uint64_t getVerifiedCount() const
+        {
+            return m_verified;
+        }
+
+    private:
+        void writeRecord(InputJournalRecord type, uint64_t tick);
+
+        //recording
+        FILE        *m_file;
+        uint64_t    m_last_tick;
+
+        //replay, tick ordered
+        bool        m_replaying;
+        vector<std::pair<uint64_t, InputEvent> > m_events;
+        uint        m_next_event;
+        vector<std::pair<uint64_t, uint32_t> > m_checksums;
+        uint        m_next_checksum;
+        uint64_t    m_end_tick;
+
+        uint64_t    m_mismatches;
+        uint64_t    m_verified;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,347 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <string.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "layerdecoder.h"
+#include "core.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! decodes base64 text on demand, whitespace (newlines etc) is skipped
+class Base64Stream
+{
+    public:
+        Base64Stream(const char *text, size_t length) :
+            m_pos(text),
+            m_end(text + length),
+            m_bits(0),
+            m_bit_count(0),
+            m_failed(false)
+        {
+        }
+
+        //! decodes up to max bytes into out, returns the number written
+        size_t read(uint8_t *out, size_t max)
+        {
+            size_t written = 0;
+            while(written < max && m_pos != m_end)
+            {
+                unsigned char c = *m_pos;
+                int value = decodeChar(c);
+
+                if(value < 0)
+                {
+                    if(c == '=')
+                    {
+                        //padding, nothing valid can follow
+                        m_pos = m_end;
+                        break;
+                    }
+                    if(c != ' ' && c != '\n' && c != '\r' && c != '\t')
+                    {
+                        m_failed = true;
+                        m_pos = m_end;
+                        break;
+                    }
+                    ++m_pos;
+                    continue;
+                }
+
+                ++m_pos;
+                m_bits = (m_bits << 6) | value;
+                m_bit_count += 6;
+
+                if(m_bit_count >= 8)
+                {
+                    m_bit_count -= 8;
+                    out[written++] = static_cast<uint8_t>(m_bits >> m_bit_count);
+                }
+            }
+            return written;
+        }
+
+        //! true if only whitespace/padding is left
+        inline bool exhausted()
+        {
+            uint8_t extra;
+            return read(&extra, 1) == 0 && !m_failed;
+        }
+
+        inline bool failed() const
+        {
+            return m_failed;
+        }
+
+    private:
+        static inline int decodeChar(unsigned char c)
+        {
+            if(c >= 'A' && c <= 'Z') return c - 'A';
+            if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if(c >= '0' && c <= '9') return c - '0' + 52;
+            if(c == '+') return 62;
+            if(c == '/') return 63;
+            return -1;
+        }
+
+        const char *m_pos;
+        const char *m_end;
+        uint32_t    m_bits;
+        int         m_bit_count;
+        bool        m_failed;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//size of the chunks handed from the base64 decoder to the decompressor
+static const size_t DECODE_CHUNK_SIZE = 16 * 1024;
+
+///////////////////////////////////////////////////////////////////////////
+
+static void fixByteOrder(vector<uint32_t> &target)
+{
+    //gids are stored little endian
+    const uint16_t probe = 1;
+    if(*reinterpret_cast<const uint8_t*>(&probe) == 1)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < target.size(); i++)
+    {
+        uint32_t v = target[i];
+        target[i] = (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static ErrorCode decodeCSV(const char *text, size_t length,
+                           size_t tile_count, vector<uint32_t> &target)
+{
+    target.clear();
+    target.reserve(tile_count);
+
+    const char *pos = text;
+    const char *end = text + length;
+
+    while(pos != end)
+    {
+        if(*pos < '0' || *pos > '9')
+        {
+            if(*pos != ',' && *pos != ' ' && *pos != '\n' &&
+               *pos != '\r' && *pos != '\t')
+            {
+                return ERROR_INVALID_DATA;
+            }
+            ++pos;
+            continue;
+        }
+
+        uint32_t gid = 0;
+        while(pos != end && *pos >= '0' && *pos <= '9')
+        {
+            uint32_t digit = *pos - '0';
+            if(gid > (UINT32_MAX - digit) / 10)
+            {
+                return ERROR_INVALID_DATA;
+            }
+            gid = gid * 10 + digit;
+            ++pos;
+        }
+
+        if(target.size() == tile_count)
+        {
+            return ERROR_INVALID_DATA;
+        }
+        target.push_back(gid);
+    }
+
+    return (target.size() == tile_count) ? OK : ERROR_INVALID_DATA;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static ErrorCode decodeBase64(Base64Stream &input, uint8_t *out, size_t out_size)
+{
+    size_t written = input.read(out, out_size);
+
+    //more data than the layer can hold is as wrong as too little
+    if(written != out_size || input.exhausted() == false)
+    {
+        return ERROR_INVALID_DATA;
+    }
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static ErrorCode decodeDeflate(Base64Stream &input, bool gzip,
+                               uint8_t *out, size_t out_size)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    //window bits + 16 makes zlib expect a gzip header
+    if(inflateInit2(&stream, gzip ? 15 + 16 : 15) != Z_OK)
+    {
+        return ERROR_OUT_OF_MEMORY;
+    }
+
+    uint8_t chunk[DECODE_CHUNK_SIZE];
+    stream.next_out = out;
+    stream.avail_out = out_size;
+
+    int ret = Z_OK;
+    while(ret == Z_OK)
+    {
+        if(stream.avail_in == 0)
+        {
+            stream.avail_in = input.read(chunk, sizeof(chunk));
+            stream.next_in = chunk;
+            if(stream.avail_in == 0)
+            {
+                break;
+            }
+        }
+
+        ret = inflate(&stream, Z_NO_FLUSH);
+    }
+
+    bool complete = (ret == Z_STREAM_END) && stream.avail_out == 0 &&
+                    stream.avail_in == 0 && input.exhausted();
+    inflateEnd(&stream);
+
+    return complete ? OK : ERROR_INVALID_DATA;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_ZSTD
+static ErrorCode decodeZstd(Base64Stream &input, uint8_t *out, size_t out_size)
+{
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    if(stream == NULL)
+    {
+        return ERROR_OUT_OF_MEMORY;
+    }
+    ZSTD_initDStream(stream);
+
+    uint8_t chunk[DECODE_CHUNK_SIZE];
+    ZSTD_inBuffer in = { chunk, 0, 0 };
+    ZSTD_outBuffer dst = { out, out_size, 0 };
+
+    size_t ret = 1;
+    while(ret != 0)
+    {
+        if(in.pos == in.size)
+        {
+            in.size = input.read(chunk, sizeof(chunk));
+            in.pos = 0;
+            if(in.size == 0)
+            {
+                break;
+            }
+        }
+
+        ret = ZSTD_decompressStream(stream, &dst, &in);
+        if(ZSTD_isError(ret))
+        {
+            break;
+        }
+    }
+
+    bool complete = (ret == 0) && dst.pos == out_size && in.pos == in.size &&
+                    input.exhausted();
+    ZSTD_freeDStream(stream);
+
+    return complete ? OK : ERROR_INVALID_DATA;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode decodeLayerData(const char *text, size_t length,
+                          const string &encoding, const string &compression,
+                          size_t tile_count, vector<uint32_t> &target)
+{
+    assert(text);
+
+    if(encoding == "csv")
+    {
+        return decodeCSV(text, length, tile_count, target);
+    }
+
+    if(encoding != "base64")
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "decodeLayerData: "
+                          "Unsupported layer encoding '%s'\n", encoding.c_str());
+        return ERROR_INVALID_DATA;
+    }
+
+    target.resize(tile_count);
+    uint8_t *out = reinterpret_cast<uint8_t*>(target.data());
+    size_t out_size = tile_count * sizeof(uint32_t);
+
+    Base64Stream input(text, length);
+    ErrorCode ret;
+
+    if(compression == "")
+    {
+        ret = decodeBase64(input, out, out_size);
+    }
+    else if(compression == "zlib" || compression == "gzip")
+    {
+        ret = decodeDeflate(input, compression == "gzip", out, out_size);
+    }
+#ifdef HAVE_ZSTD
+    else if(compression == "zstd")
+    {
+        ret = decodeZstd(input, out, out_size);
+    }
+#endif
+    else
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "decodeLayerData: "
+                          "Unsupported layer compression '%s'\n", compression.c_str());
+        ret = ERROR_INVALID_DATA;
+    }
+
+    if(ret != OK)
+    {
+        target.clear();
+        return ret;
+    }
+
+    fixByteOrder(target);
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
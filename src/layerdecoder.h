@@ -0,0 +1,64 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef LAYERDECODER_H
+#define LAYERDECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "errorcodes.h"
+
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+//TMX stores tile flipping in the upper bits of a gid
+static const uint32_t GID_FLIPPED_HORIZONTALLY  = 0x80000000;
+static const uint32_t GID_FLIPPED_VERTICALLY    = 0x40000000;
+static const uint32_t GID_FLIPPED_DIAGONALLY    = 0x20000000;
+static const uint32_t GID_MASK                  = 0x1FFFFFFF;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! decodes the text of a TMX <data> element into gids
+//!
+//! encoding is "csv", "base64" or empty (not supported, XML tiles),
+//! compression is "", "zlib", "gzip" or "zstd" (only with HAVE_ZSTD).
+//! Compressed data is inflated straight from the base64 text into the
+//! target array, no intermediate copy of the whole payload is made.
+//! tile_count is width * height of the layer, target is resized to it.
+ErrorCode decodeLayerData(const char *text, size_t length,
+                          const string &encoding, const string &compression,
+                          size_t tile_count, vector<uint32_t> &target);
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -25,6 +25,7 @@
  *-----------------------------------------------------------------------*/
 
 #include <assert.h>
+#include <chrono>
 
 #include "logging.h"
 
@@ -32,7 +33,11 @@
 
 Logger::Logger(enum LogLevel log_level, const string &logging_file_path) :
                m_logging_level(log_level), m_logging_file(NULL),
-               m_logging_file_path(logging_file_path)
+               m_logging_categories(0),
+               m_logging_file_path(logging_file_path),
+               m_queue(NULL), m_queue_size(0), m_overflow(LOG_OVERFLOW_DROP),
+               m_async(false), m_stop_writer(false), m_dropped_messages(0),
+               m_binary_file(NULL), m_binary(false)
 {
     addLoggingCategory(LOG_APP);
 }
@@ -41,6 +46,9 @@ Logger::Logger(enum LogLevel log_level, const string &logging_file_path) :
 
 Logger::~Logger()
 {
+    stopAsync();
+    delete m_queue;
+    stopBinary();
     closeLoggingFile();
 }
 
@@ -76,54 +84,31 @@ void Logger::logMessage(enum LogLevel log_level, enum LogCategory log_category,
     if(log_level <= m_logging_level && 
       (m_logging_categories & log_category) == log_category)
     {
-        char *current_time = getCurrentTime();
         va_list args;
         va_start(args, format);
 
-        switch(log_level)
+        if(log_level != LOG_FATAL && m_async.load(std::memory_order_acquire) == true)
         {
-            case LOG_FATAL:
-                fprintf(stderr, "%s ", current_time);
-                vfprintf(stderr, format, args);
-                break;
-            case LOG_ERROR:
-                fprintf(stderr, "%s ", current_time);
-                vfprintf(stderr, format, args);
-                break;
-            case LOG_WARNING:
-                fprintf(stdout, "%s ", current_time);
-                vfprintf(stdout, format, args);
-                break;
-            case LOG_INFO:
-                fprintf(stdout, "%s ", current_time);
-                vfprintf(stdout, format, args);
-                break;
-            case LOG_DEBUG:
-                fprintf(stdout, "%s ", current_time);
-                vfprintf(stdout, format, args);
-                break;
-            case LOG_DEBUG2:
-                fprintf(stdout, "%s ", current_time);
-                vfprintf(stdout, format, args);
-                break;
-            case LOG_STATE:
-                fprintf(stdout, "%s ", current_time);
-                vfprintf(stdout, format, args);
-                break;
-            default:
-                break;
+            logAsync(log_level, format, args);
         }
-        va_end(args);
-
-        if(m_logging_file != NULL)
+        else
         {
-            va_start(args, format);
-            fprintf(m_logging_file, "%s ", current_time);
-            vfprintf(m_logging_file, format, args);
-            va_end(args);
+            //fatal messages have to be out before we exit
+            if(log_level == LOG_FATAL)
+            {
+                stopAsync();
+                stopBinary();
+            }
+
+            char current_time[TIME_SIZE];
+            formatTime(time(NULL), current_time);
+
+            char text[SYNC_TEXT_SIZE];
+            vsnprintf(text, sizeof(text), format, args);
+            writeMessage(log_level, current_time, text);
         }
 
-        free(current_time);
+        va_end(args);
     }
 
     if(log_level == LOG_FATAL)
@@ -134,8 +119,340 @@ void Logger::logMessage(enum LogLevel log_level, enum LogCategory log_category,
 
 ///////////////////////////////////////////////////////////////////////////
 
+void Logger::logAsync(enum LogLevel log_level, const char *format, va_list args)
+{
+    size_t position;
+    LogRecord *record = m_queue->reserve(&position);
+
+    while(record == NULL)
+    {
+        if(m_overflow == LOG_OVERFLOW_DROP)
+        {
+            m_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::this_thread::yield();
+        record = m_queue->reserve(&position);
+    }
+
+    //formatted here, the arguments (c_str() and the like) may be gone
+    //by the time the writer gets to the record
+    record->level = log_level;
+    record->timestamp = time(NULL);
+    record->binary_size = 0;
+    int length = vsnprintf(record->text, LogRecord::TEXT_SIZE, format, args);
+
+    //the record is smaller than the sync buffer, so mark what was cut off
+    if(length >= static_cast<int>(LogRecord::TEXT_SIZE))
+    {
+        size_t format_length = strlen(format);
+        const char *marker = (format_length > 0 && format[format_length - 1] == '\n') ?
+                             "...\n" : "...";
+        strcpy(record->text + LogRecord::TEXT_SIZE - strlen(marker) - 1, marker);
+    }
+
+    m_queue->commit(position);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::writeMessage(enum LogLevel log_level, const char *current_time,
+                          const char *text)
+{
+    FILE *stream = NULL;
+
+    switch(log_level)
+    {
+        case LOG_FATAL:
+        case LOG_ERROR:
+            stream = stderr;
+            break;
+        case LOG_WARNING:
+        case LOG_INFO:
+        case LOG_DEBUG:
+        case LOG_DEBUG2:
+        case LOG_STATE:
+            stream = stdout;
+            break;
+        default:
+            return;
+    }
+
+    //one call per line, stdio locks per call so lines never interleave
+    fprintf(stream, "%s %s", current_time, text);
+
+    if(m_logging_file != NULL)
+    {
+        fprintf(m_logging_file, "%s %s", current_time, text);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::startAsync(size_t queue_size, LogOverflow overflow)
+{
+    if(m_async.load() == true)
+    {
+        return;
+    }
+
+    delete m_queue;
+    m_queue = new LogQueue(queue_size);
+    m_queue_size = queue_size;
+    m_overflow = overflow;
+    m_stop_writer = false;
+
+    m_writer = std::thread(&Logger::runWriter, this);
+    m_async.store(true, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::stopAsync()
+{
+    if(m_async.exchange(false) == false)
+    {
+        return;
+    }
+
+    //the writer drains the queue before it returns
+    m_stop_writer = true;
+    m_writer.join();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::runWriter()
+{
+    char current_time[TIME_SIZE];
+    time_t formatted_time = 0;
+    current_time[0] = '\0';
+
+    uint64_t reported_drops = 0;
+
+    while(true)
+    {
+        LogRecord *record = m_queue->peek();
+        if(record == NULL)
+        {
+            uint64_t drops = m_dropped_messages.load(std::memory_order_relaxed);
+            if(drops != reported_drops)
+            {
+                fprintf(stderr, "%s Logger: %llu messages dropped, queue full\n", current_time,
+                        static_cast<unsigned long long>(drops - reported_drops));
+                reported_drops = drops;
+            }
+
+            fflush(stdout);
+            if(m_logging_file != NULL)
+            {
+                fflush(m_logging_file);
+            }
+            if(m_binary.load(std::memory_order_acquire) == true)
+            {
+                fflush(m_binary_file);
+            }
+
+            if(m_stop_writer.load() == true)
+            {
+                //a last look, producers may have committed in between
+                if(m_queue->peek() == NULL)
+                {
+                    break;
+                }
+                continue;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        if(record->binary_size != 0)
+        {
+            fwrite(record->text, 1, record->binary_size, m_binary_file);
+            m_queue->release();
+            continue;
+        }
+
+        //most messages share the second of the one before
+        if(record->timestamp != formatted_time)
+        {
+            formatTime(record->timestamp, current_time);
+            formatted_time = record->timestamp;
+        }
+
+        writeMessage(static_cast<enum LogLevel>(record->level), current_time, record->text);
+        m_queue->release();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
 void Logger::addLoggingCategory(enum LogCategory category)
 {
     m_logging_categories |= category;
 }
 
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode Logger::startBinary(const string &filename)
+{
+    if(m_binary.load() == true)
+    {
+        stopBinary();
+    }
+
+    FILE *file = fopen(filename.c_str(), "wb");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    BinaryLogHeader header;
+    memcpy(header.magic, BINARYLOG_MAGIC, sizeof(header.magic));
+    header.version = BINARYLOG_VERSION;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.realtime_ns = static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    header.monotonic_ns = static_cast<int64_t>(getMonotonicTime());
+
+    if(fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        return ERROR_OPENING_FILE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_format_mutex);
+    m_binary_file = file;
+
+    //call sites keep their ids, the new file needs their formats too
+    for(uint i = 0; i < m_formats.size(); i++)
+    {
+        writeFormat(m_formats[i]);
+    }
+
+    m_binary.store(true, std::memory_order_release);
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::stopBinary()
+{
+    if(m_binary.exchange(false) == false)
+    {
+        return;
+    }
+
+    //the writer thread may still hold binary records, let it finish them
+    bool restart_async = isAsync();
+    stopAsync();
+
+    fclose(m_binary_file);
+    m_binary_file = NULL;
+
+    if(restart_async == true)
+    {
+        startAsync(m_queue_size, m_overflow);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint32_t Logger::registerFormat(std::atomic<uint32_t> *format_id,
+                                enum LogLevel log_level, enum LogCategory log_category,
+                                const char *file, int line, const char *format)
+{
+    std::lock_guard<std::mutex> lock(m_format_mutex);
+
+    //another thread may have been first
+    uint32_t id = format_id->load(std::memory_order_relaxed);
+    if(id != 0)
+    {
+        return id;
+    }
+
+    BinaryLogFormat entry;
+    entry.id = m_formats.size() + 1;
+    entry.level = log_level;
+    entry.category = log_category;
+    entry.file = file;
+    entry.line = line;
+    entry.format = format;
+    m_formats.push_back(entry);
+
+    //written right away, so it is in the file before any of its messages
+    if(m_binary_file != NULL)
+    {
+        writeFormat(entry);
+    }
+
+    format_id->store(entry.id, std::memory_order_release);
+    return entry.id;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::writeFormat(const BinaryLogFormat &format)
+{
+    size_t file_length = strlen(format.file);
+    size_t format_length = strlen(format.format);
+
+    vector<char> buffer(16 + file_length + format_length);
+    BinaryLogEncoder encoder(buffer.data(), buffer.size());
+    encoder.putRaw(static_cast<uint8_t>(BINLOG_FORMAT));
+    encoder.putRaw(format.id);
+    encoder.putRaw(static_cast<uint8_t>(format.level));
+    encoder.putRaw(static_cast<uint8_t>(format.category));
+    encoder.putRaw(static_cast<uint32_t>(format.line));
+    encoder.putString(format.file, file_length);
+    encoder.putString(format.format, format_length);
+
+    //one call, stdio keeps it in one piece next to the writer thread
+    fwrite(buffer.data(), 1, encoder.getSize(), m_binary_file);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Logger::writeBinary(enum LogLevel log_level, const char *data, size_t size)
+{
+    if(m_async.load(std::memory_order_acquire) == false)
+    {
+        fwrite(data, 1, size, m_binary_file);
+        return;
+    }
+
+    size_t position;
+    LogRecord *record = m_queue->reserve(&position);
+
+    while(record == NULL)
+    {
+        if(m_overflow == LOG_OVERFLOW_DROP)
+        {
+            m_dropped_messages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        std::this_thread::yield();
+        record = m_queue->reserve(&position);
+    }
+
+    record->level = log_level;
+    record->timestamp = 0;
+    record->binary_size = size;
+    memcpy(record->text, data, size);
+
+    m_queue->commit(position);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t Logger::getMonotonicTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
@@ -31,9 +31,19 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "common.h"
 #include "errorcodes.h"
+#include "binarylog.h"
+#include "logqueue.h"
+
+using std::vector;
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -59,6 +69,30 @@ enum LogCategory
     LOG_PLAYER          = 64
 };
 
+//! Messages above this level or outside these categories are compiled
+//! out of LOGMESSAGE statements (see core.h), set them for release builds
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_STATE
+#endif
+
+#ifndef LOG_COMPILE_CATEGORIES
+#define LOG_COMPILE_CATEGORIES 0xff
+#endif
+
+//fatal messages always stay in, they end the program
+#define LOG_COMPILED_IN(level, category) \
+    ((level) == LOG_FATAL || \
+     ((level) <= (LOG_COMPILE_LEVEL) && ((category) & (LOG_COMPILE_CATEGORIES)) == (category)))
+
+///////////////////////////////////////////////////////////////////////////
+
+//! what async logging does when the queue is full
+enum LogOverflow
+{
+    LOG_OVERFLOW_DROP,
+    LOG_OVERFLOW_BLOCK
+};
+
 ///////////////////////////////////////////////////////////////////////////
 
 class Logger
@@ -72,6 +106,82 @@ class Logger
                         const char *format, ...);
         void addLoggingCategory(enum LogCategory category);
 
+        //! runtime filter, checked before the arguments are evaluated
+        inline bool isEnabled(enum LogLevel log_level, enum LogCategory log_category) const
+        {
+            return log_level == LOG_FATAL ||
+                   (log_level <= m_logging_level &&
+                    (m_logging_categories & log_category) == log_category);
+        }
+
+        //! messages are formatted by the caller and handed to a writer
+        //! thread through a lock-free queue of queue_size entries; text past
+        //! LogRecord::TEXT_SIZE is cut off and marked with "..."
+        void startAsync(size_t queue_size = DEFAULT_QUEUE_SIZE,
+                        LogOverflow overflow = LOG_OVERFLOW_DROP);
+
+        //! writes everything queued and goes back to synchronous logging,
+        //! other threads must not log while this runs
+        void stopAsync();
+
+        inline bool isAsync() const
+        {
+            return m_async.load(std::memory_order_relaxed);
+        }
+
+        //! Call sites register their format once and messages only carry
+        //! its id, a monotonic timestamp and the raw arguments; see
+        //! binarylog.h. Errors are still printed as text as well.
+        ErrorCode startBinary(const string &filename);
+
+        //! other threads must not log while this runs
+        void stopBinary();
+
+        inline bool isBinary() const
+        {
+            return m_binary.load(std::memory_order_acquire);
+        }
+
+        //! used by LOGMESSAGE, format_id caches the id of the call site
+        template<typename... Args>
+        void logBinary(std::atomic<uint32_t> *format_id, enum LogLevel log_level,
+                       enum LogCategory log_category, const char *file, int line,
+                       const char *format, const Args&... args)
+        {
+            uint32_t id = format_id->load(std::memory_order_acquire);
+            if(id == 0)
+            {
+                id = registerFormat(format_id, log_level, log_category, file, line, format);
+            }
+
+            char buffer[LogRecord::TEXT_SIZE];
+            BinaryLogEncoder encoder(buffer, sizeof(buffer));
+            encoder.putRaw(static_cast<uint8_t>(BINLOG_MESSAGE));
+            encoder.putRaw(id);
+            encoder.putRaw(getMonotonicTime());
+            encoder.putRaw(static_cast<uint16_t>(0));
+            encodeLogArguments(encoder, args...);
+
+            //patch in the argument byte count now that it is known
+            uint16_t argument_bytes = static_cast<uint16_t>(
+                encoder.getSize() - BINARYLOG_MESSAGE_HEADER_SIZE);
+            memcpy(buffer + BINARYLOG_MESSAGE_HEADER_SIZE - sizeof(argument_bytes),
+                   &argument_bytes, sizeof(argument_bytes));
+
+            writeBinary(log_level, buffer, encoder.getSize());
+
+            if(log_level <= LOG_ERROR)
+            {
+                logMessage(log_level, log_category, format, args...);
+            }
+        }
+
+        //! messages lost to a full queue (LOG_OVERFLOW_DROP)
+        inline uint64_t getDroppedMessages() const
+        {
+            return m_dropped_messages.load(std::memory_order_relaxed);
+        }
+
         enum LogLevel getLogLevel() const
         {
             return m_logging_level;
@@ -88,18 +198,39 @@ class Logger
         }
 
     private:
-        inline char* getCurrentTime() const
+        static const size_t DEFAULT_QUEUE_SIZE = 4096;
+        static const size_t TIME_SIZE = 10;
+        static const size_t SYNC_TEXT_SIZE = 1024;
+
+        //! thread-safe and without allocations, buffer needs TIME_SIZE
+        inline void formatTime(time_t rawtime, char *buffer) const
         {
-            time_t rawtime;
-            struct tm *timeinfo;
+            struct tm timeinfo;
+            localtime_r(&rawtime, &timeinfo);
+            strftime(buffer, TIME_SIZE, "%T", &timeinfo);
+        }
 
-            char *buffer = (char*) malloc(sizeof(char) * 10);
+        void logAsync(enum LogLevel log_level, const char *format, va_list args);
+        void writeMessage(enum LogLevel log_level, const char *current_time,
+                          const char *text);
+        void runWriter();
 
-            time(&rawtime);
-            timeinfo = localtime(&rawtime);
-            strftime(buffer, 10, "%T", timeinfo);
-            return buffer;
-        }
+        struct BinaryLogFormat
+        {
+            uint32_t        id;
+            enum LogLevel   level;
+            enum LogCategory category;
+            const char      *file;
+            int             line;
+            const char      *format;
+        };
+
+        uint32_t registerFormat(std::atomic<uint32_t> *format_id,
+                                enum LogLevel log_level, enum LogCategory log_category,
+                                const char *file, int line, const char *format);
+        void writeFormat(const BinaryLogFormat &format);
+        void writeBinary(enum LogLevel log_level, const char *data, size_t size);
+        static uint64_t getMonotonicTime();
 
         ErrorCode openLoggingFile();
         void closeLoggingFile();
@@ -109,6 +240,21 @@ class Logger
         unsigned char   m_logging_categories;
         string          m_logging_file_path;
 
+        LogQueue        *m_queue;
+        size_t          m_queue_size;
+        LogOverflow     m_overflow;
+        std::thread     m_writer;
+        std::atomic<bool>       m_async;
+        std::atomic<bool>       m_stop_writer;
+        std::atomic<uint64_t>   m_dropped_messages;
+
+        FILE            *m_binary_file;
+        std::atomic<bool>       m_binary;
+
+        //call site formats, written again at the start of every file
+        std::mutex      m_format_mutex;
+        vector<BinaryLogFormat> m_formats;
+
         DISABLECOPY(Logger);
 };
 
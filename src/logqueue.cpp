@@ -0,0 +1,124 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "logqueue.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+LogQueue::LogQueue(size_t capacity) :
+    m_enqueue_position(0),
+    m_dequeue_position(0)
+{
+    size_t size = 2;
+    while(size < capacity)
+    {
+        size = size * 2;
+    }
+
+    m_slots = new Slot[size];
+    m_mask = size - 1;
+
+    for(size_t i = 0; i < size; i++)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+LogQueue::~LogQueue()
+{
+    delete[] m_slots;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+LogRecord* LogQueue::reserve(size_t *position)
+{
+    size_t pos = m_enqueue_position.load(std::memory_order_relaxed);
+
+    while(true)
+    {
+        Slot &slot = m_slots[pos & m_mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+        if(difference == 0)
+        {
+            //slot is free for this lap, try to claim it
+            if(m_enqueue_position.compare_exchange_weak(pos, pos + 1,
+                                                        std::memory_order_relaxed))
+            {
+                *position = pos;
+                return &slot.record;
+            }
+        }
+        else if(difference < 0)
+        {
+            //consumer has not released it yet, ring is full
+            return NULL;
+        }
+        else
+        {
+            //another producer was faster
+            pos = m_enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void LogQueue::commit(size_t position)
+{
+    m_slots[position & m_mask].sequence.store(position + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+LogRecord* LogQueue::peek()
+{
+    Slot &slot = m_slots[m_dequeue_position & m_mask];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+    if(sequence != m_dequeue_position + 1)
+    {
+        return NULL;
+    }
+    return &slot.record;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void LogQueue::release()
+{
+    Slot &slot = m_slots[m_dequeue_position & m_mask];
+
+    //free for the producers of the next lap
+    slot.sequence.store(m_dequeue_position + m_mask + 1, std::memory_order_release);
+    m_dequeue_position++;
+}
+
+///////////////////////////////////////////////////////////////////////////
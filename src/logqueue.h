@@ -0,0 +1,99 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "common.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one formatted message waiting for the writer thread
+struct LogRecord
+{
+    //! longer messages end in "..." when they come out of the queue
+    static const size_t TEXT_SIZE = 256;
+
+    int     level;
+    time_t  timestamp;
+    char    text[TEXT_SIZE];
+
+    //0 for text, otherwise text holds a binary log record this long
+    size_t  binary_size;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Bounded lock-free multi producer / single consumer ring
+//!
+//! Vyukov's bounded queue: every slot carries a sequence number, producers
+//! claim a position with one CAS and publish the slot by bumping its
+//! sequence. Producers never wait for each other or for the consumer
+//! unless the ring is full.
+class LogQueue
+{
+    DISABLECOPY(LogQueue);
+
+    public:
+        //! capacity is rounded up to a power of two
+        explicit LogQueue(size_t capacity);
+        ~LogQueue();
+
+        //! producer: claims a slot to fill, NULL if the ring is full;
+        //! the slot has to be handed back with commit()
+        LogRecord* reserve(size_t *position);
+        void commit(size_t position);
+
+        //! consumer: oldest committed record, NULL if there is none;
+        //! release() the record before asking for the next one
+        LogRecord* peek();
+        void release();
+
+    private:
+        struct Slot
+        {
+            std::atomic<size_t> sequence;
+            LogRecord record;
+        };
+
+        Slot *m_slots;
+        size_t m_mask;
+
+        //padded apart, producers and consumer hammer different ones
+        char m_pad_before[64];
+        std::atomic<size_t> m_enqueue_position;
+        char m_pad_between[64];
+        size_t m_dequeue_position;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
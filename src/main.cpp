@@ -31,81 +31,635 @@
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <utility>
 
 #include "xmlloader.h"
 #include "clippedmap.h"
+#include "maploader.h"
 #include "objecthandler.h"
 #include "inputhandler.h"
+#include "framepipeline.h"
+#include "fixedtimestep.h"
+#include "inputjournal.h"
+#include "trace.h"
 
 using std::dynamic_pointer_cast;
+using std::pair;
 
-int main(int argc, char* argv[])
+//! simulation rate, rendering runs as fast as presenting allows
+static const uint SIM_TICKS_PER_SECOND = 60;
+//! catch-up cap, a quarter second behind is dropped instead of simulated
+static const uint MAX_TICKS_PER_FRAME = SIM_TICKS_PER_SECOND / 4;
+
+//! --trace=<file>, written on F12 and at exit
+static string trace_filename;
+
+//! --record=<file> / --replay=<file>
+static InputJournal input_journal;
+
+///////////////////////////////////////////////////////////////////////////
+
+static void writeTrace()
 {
-    GameCore &core = GameCore::instance();
-    core.logger().setLogLevel(LOG_DEBUG2);
-    core.logger().addLoggingCategory(LOG_CORE);
-    core.logger().addLoggingCategory(LOG_MAP);
-    core.logger().addLoggingCategory(LOG_SDL2_GRAPHICS);
-    core.logger().addLoggingCategory(LOG_PLAYER);
+    if(trace_filename.empty() == true)
+    {
+        return;
+    }
+
+    ErrorCode ret = Tracer::instance().writeChromeTrace(trace_filename);
+    if(ret != OK)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_CORE, "writeTrace: %s: %s\n",
+                   trace_filename.c_str(), ERRORMSG(ret).c_str());
+    }
+    else
+    {
+        LOGMESSAGE(LOG_INFO, LOG_CORE, "writeTrace: trace written to %s\n",
+                   trace_filename.c_str());
+    }
+}
 
-    LoadedMap lmap("../res/maps/testmap.tmx");
-    ErrorCode file_loaded = lmap.loadFile();
-    UNUSED(file_loaded);
+///////////////////////////////////////////////////////////////////////////
 
-    GraphicsCore &gcore = GraphicsCore::instance();
-    gcore.initializeWindow();
-    gcore.initializeRenderer();
+//! time between two presented frames, in microseconds
+static void recordFrameTime(std::chrono::steady_clock::time_point *last_present)
+{
+    static MetricHistogram &frame_time = GameCore::instance().metrics().histogram("frame_time_us");
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(*last_present != std::chrono::steady_clock::time_point())
+    {
+        frame_time.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                          now - *last_present).count());
+    }
+    *last_present = now;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! puts a freshly loaded map into the scene, returns the replaced one
+static shared_ptr<ClippedMap> swapInMap(shared_ptr<ClippedMap> &clipped,
+                                        shared_ptr<ClippedMap> loaded,
+                                        shared_ptr<Player> player)
+{
+    Objecthandler &handler = Objecthandler::instance();
+
+    loaded.get()->setViewport(0, -100);
+
+    //the player lives on the first object group of the map
+    const vector<ObjectGroup> &groups = loaded.get()->getLoadedMap().getObjectGroups();
+    if(groups.empty() == false)
+    {
+        player.get()->setRenderLayer(RENDER_LAYER_OBJECTS,
+                                     drawOrderFromString(groups.at(0).draworder));
+    }
+
+    //keep maps in front of the objects moving on them
+    if(clipped.get() != NULL)
+    {
+        handler.replaceGameObject(clipped, loaded);
+    }
+    else
+    {
+        handler.insertGameObject(0, loaded);
+    }
+
+    shared_ptr<ClippedMap> replaced = clipped;
+    clipped = loaded;
+    return replaced;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! live input, a replay only lets through what is not simulation input
+static void deliverEvent(InputEvent event, uint64_t tick)
+{
+    Objecthandler &handler = Objecthandler::instance();
+
+    if(event == RENDER_TARGETS_RESET || event == WRITE_TRACE)
+    {
+        handler.reactToKeyEvent(event);
+        return;
+    }
+
+    if(input_journal.isReplaying() == true)
+    {
+        return;
+    }
+
+    handler.reactToKeyEvent(event);
+    input_journal.recordEvent(tick, event);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! one simulation tick, replays hand in the events recorded for it
+static void simulateTick(uint64_t tick)
+{
+    Objecthandler &handler = Objecthandler::instance();
+
+    if(input_journal.isReplaying() == true)
+    {
+        InputEvent event = input_journal.nextEvent(tick);
+        while(event != NONE)
+        {
+            handler.reactToKeyEvent(event);
+            event = input_journal.nextEvent(tick);
+        }
+    }
+
+    handler.updateAll();
+
+    if(input_journal.isRecording() == true)
+    {
+        input_journal.recordChecksum(tick, handler.getStateChecksum());
+    }
+    else if(input_journal.isReplaying() == true)
+    {
+        input_journal.verifyChecksum(tick, handler.getStateChecksum());
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
 
+//! true once a replay has run all ticks of its recording
+static bool replayFinished(uint64_t tick_count)
+{
+    return input_journal.isReplaying() == true &&
+           tick_count >= input_journal.getTickCount();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! blocks until the map is loaded; recordings and replays have to start
+//! their first tick on the same scene, whatever the loading time
+static shared_ptr<ClippedMap> waitForMap(AsyncMapLoader &map_loader)
+{
+    while(map_loader.isBusy() == true)
+    {
+        shared_ptr<ClippedMap> loaded = map_loader.poll();
+        if(loaded.get() != NULL)
+        {
+            return loaded;
+        }
+        SDL_Delay(1);
+    }
+
+    return shared_ptr<ClippedMap>();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static void runSerial(AsyncMapLoader &map_loader, shared_ptr<Player> player)
+{
+    GraphicsCore &gcore = GraphicsCore::instance();
     Objecthandler &handler = Objecthandler::instance();
-    UNUSED(handler);
+    Inputhandler &input = Inputhandler::instance();
+
+    shared_ptr<ClippedMap> clipped;
+    if(input_journal.isRecording() == true || input_journal.isReplaying() == true)
+    {
+        shared_ptr<ClippedMap> loaded = waitForMap(map_loader);
+        if(loaded.get() != NULL)
+        {
+            swapInMap(clipped, loaded, player);
+        }
+    }
+
+    FixedTimestep timestep(SIM_TICKS_PER_SECOND, MAX_TICKS_PER_FRAME);
+    std::chrono::steady_clock::time_point last_present;
+
+    while(replayFinished(timestep.getTickCount()) == false)
+    {
+        //swap in finished maps before anything of this frame is updated
+        if(map_loader.isBusy() == true)
+        {
+            shared_ptr<ClippedMap> loaded = map_loader.poll();
+            if(loaded.get() != NULL)
+            {
+                swapInMap(clipped, loaded, player);
+            }
+        }
+
+        {
+            TRACE_ZONE("input");
+            InputEvent event = input.getNextEvent();
+            while(event != NONE)
+            {
+                if(event == QUIT)
+                {
+                    return;
+                }
+                if(event == WRITE_TRACE)
+                {
+                    writeTrace();
+                }
+                deliverEvent(event, timestep.getTickCount());
+                event = input.getNextEvent();
+            }
+        }
+
+        uint ticks = timestep.advance();
+        TRACE_COUNTER("simulation ticks", ticks);
+        uint64_t first_tick = timestep.getTickCount() - ticks;
+        for(uint i = 0; i < ticks; i++)
+        {
+            simulateTick(first_tick + i);
+        }
 
+        gcore.clearRenderer();
+        handler.drawAll(timestep.getAlpha());
+        gcore.presentRenderer();
+        recordFrameTime(&last_present);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Benchmark loop without display: one simulation tick per iteration as
+//! fast as it goes, drawn to the offscreen surface in DISPLAY_OFFSCREEN.
+//! Stops after max_ticks (0 runs until QUIT, e.g. SIGINT) and prints the
+//! throughput.
+static void runHeadless(AsyncMapLoader &map_loader, shared_ptr<Player> player,
+                        uint64_t max_ticks)
+{
+    GraphicsCore &gcore = GraphicsCore::instance();
+    Objecthandler &handler = Objecthandler::instance();
     Inputhandler &input = Inputhandler::instance();
-    UNUSED(handler);
 
-    shared_ptr<ClippedMap> clipped(new ClippedMap(&lmap));
-    clipped.get()->copyTilesToRender(0, -100);
+    bool render = gcore.getDisplayMode() == DISPLAY_OFFSCREEN;
 
-    shared_ptr<Player> player(new Player("../res/player.bmp", 20, 300));
+    //loading is not what we measure, wait for the map first
+    shared_ptr<ClippedMap> clipped;
+    shared_ptr<ClippedMap> loaded = waitForMap(map_loader);
+    if(loaded.get() != NULL)
+    {
+        swapInMap(clipped, loaded, player);
+    }
 
-    handler.addGameObject(clipped);
-    handler.addGameObject(player);
+    if(max_ticks == 0 && input_journal.isReplaying() == true)
+    {
+        max_ticks = input_journal.getTickCount();
+    }
 
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point last_present;
+    uint64_t ticks = 0;
     bool quit = false;
-	const int MAX_FPS = 60;
-	const int MAX_DELTA_MS = 1.0f / MAX_FPS * 1000;
-	unsigned int startTicks = SDL_GetTicks();
-	unsigned int deltaMs = MAX_DELTA_MS;
-	unsigned int endTicks = SDL_GetTicks();
 
-    while(quit == false)
+    while(quit == false && (max_ticks == 0 || ticks < max_ticks))
     {
-		startTicks = SDL_GetTicks();
-        gcore.clearRenderer();
         InputEvent event = input.getNextEvent();
         while(event != NONE)
         {
             if(event == QUIT)
             {
-                goto stop;
+                quit = true;
             }
-            handler.reactToKeyEvent(event);
+            deliverEvent(event, ticks);
             event = input.getNextEvent();
         }
 
-        handler.updateAll();
-        handler.drawAll();
+        simulateTick(ticks);
+        ticks++;
+
+        if(render == true)
+        {
+            gcore.clearRenderer();
+            handler.drawAll(1.0f);
+            gcore.presentRenderer();
+            recordFrameTime(&last_present);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%s: %llu ticks in %.3f s, %.1f ticks/s\n",
+           render ? "offscreen" : "headless",
+           static_cast<unsigned long long>(ticks), seconds,
+           seconds > 0.0 ? ticks / seconds : 0.0);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! state shared by the render (main) and the simulation thread
+struct PipelineState
+{
+    PipelineState() :
+        quit(false)
+    {
+    }
+
+    FramePipeline pipeline;
+    std::atomic<bool> quit;
+
+    //everything below is guarded by mutex
+    std::mutex mutex;
+    vector<InputEvent> events;
+    //uploaded by the render thread, put into the scene by the simulation
+    shared_ptr<ClippedMap> pending_map;
+    //replaced maps, destroyed on the render thread (they own textures)
+    //once a frame with at least this number has been drawn
+    vector<pair<uint64_t, shared_ptr<ClippedMap> > > retired_maps;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+static void runSimulation(PipelineState *state, shared_ptr<Player> player)
+{
+    GraphicsCore &gcore = GraphicsCore::instance();
+    Objecthandler &handler = Objecthandler::instance();
+
+    shared_ptr<ClippedMap> clipped;
+    vector<InputEvent> events;
+
+    FixedTimestep timestep(SIM_TICKS_PER_SECOND, MAX_TICKS_PER_FRAME);
+
+    TRACE_THREAD_NAME("simulation");
+
+    while(state->quit.load() == false)
+    {
+        shared_ptr<ClippedMap> loaded;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            events.swap(state->events);
+            loaded.swap(state->pending_map);
+        }
+
+        if(loaded.get() != NULL)
+        {
+            shared_ptr<ClippedMap> replaced = swapInMap(clipped, loaded, player);
+            if(replaced.get() != NULL)
+            {
+                //frames from now on do not reference the old map anymore
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->retired_maps.push_back(std::make_pair(state->pipeline.getNextFrameNumber(),
+                                                             replaced));
+            }
+        }
+
+        for(uint i = 0; i < events.size(); i++)
+        {
+            deliverEvent(events[i], timestep.getTickCount());
+        }
+        events.clear();
+
+        uint ticks = timestep.advance();
+        TRACE_COUNTER("simulation ticks", ticks);
+        uint64_t first_tick = timestep.getTickCount() - ticks;
+        for(uint i = 0; i < ticks; i++)
+        {
+            simulateTick(first_tick + i);
+        }
+
+        if(replayFinished(timestep.getTickCount()) == true)
+        {
+            state->quit = true;
+        }
+
+        //record an immutable snapshot for the render thread, snapshots
+        //hold the simulated state itself, so there is nothing to blend
+        if(ticks > 0)
+        {
+            gcore.setRecordQueue(&state->pipeline.beginFrame());
+            handler.drawAll(1.0f);
+            state->pipeline.publishFrame();
+        }
+
+        //independent of how long presenting takes
+        SDL_Delay(timestep.getMsUntilNextTick());
+    }
+
+    //the scene is gone, maps still in it go with the render thread
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if(clipped.get() != NULL)
+    {
+        handler.removeGameObject(clipped);
+        state->retired_maps.push_back(std::make_pair(state->pipeline.getNextFrameNumber(),
+                                                     clipped));
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//! simulation on a worker thread, SDL (events, rendering) stays here
+static void runPipelined(AsyncMapLoader &map_loader, shared_ptr<Player> player)
+{
+    GraphicsCore &gcore = GraphicsCore::instance();
+    Inputhandler &input = Inputhandler::instance();
+
+    PipelineState state;
+    if(input_journal.isRecording() == true || input_journal.isReplaying() == true)
+    {
+        //swapped in by the simulation before its first tick
+        state.pending_map = waitForMap(map_loader);
+    }
+
+    std::thread simulation(runSimulation, &state, player);
+    std::chrono::steady_clock::time_point last_present;
+
+    while(state.quit.load() == false)
+    {
+        {
+            TRACE_ZONE("input");
+            InputEvent event = input.getNextEvent();
+            while(event != NONE)
+            {
+                if(event == QUIT)
+                {
+                    state.quit = true;
+                    break;
+                }
+                if(event == WRITE_TRACE)
+                {
+                    writeTrace();
+                }
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.events.push_back(event);
+                event = input.getNextEvent();
+            }
+        }
+
+        //texture upload has to happen here, the scene swap does not
+        if(map_loader.isBusy() == true)
+        {
+            shared_ptr<ClippedMap> loaded = map_loader.poll();
+            if(loaded.get() != NULL)
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                state.pending_map = loaded;
+            }
+        }
+
+        RenderQueue *frame = state.pipeline.acquireFrame();
+        if(frame == NULL)
+        {
+            //simulation has not finished a new frame yet
+            SDL_Delay(1);
+            continue;
+        }
+
+        gcore.clearRenderer();
+        {
+            TRACE_ZONE("RenderQueue::submit");
+            frame->submit();
+        }
         gcore.presentRenderer();
+        recordFrameTime(&last_present);
+
+        vector<shared_ptr<ClippedMap> > unused_maps;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            for(uint i = 0; i < state.retired_maps.size(); )
+            {
+                if(state.retired_maps[i].first <= state.pipeline.getAcquiredFrameNumber())
+                {
+                    unused_maps.push_back(state.retired_maps[i].second);
+                    state.retired_maps.erase(state.retired_maps.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+        }
+        //destroyed here, outside the lock
+    }
+
+    simulation.join();
+    gcore.setRecordQueue(NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    GameCore &core = GameCore::instance();
+    core.logger().setLogLevel(LOG_DEBUG2);
+    core.logger().addLoggingCategory(LOG_CORE);
+    core.logger().addLoggingCategory(LOG_MAP);
+    core.logger().addLoggingCategory(LOG_SDL2_GRAPHICS);
+    core.logger().addLoggingCategory(LOG_PLAYER);
+
+    //keep stdout/file writes off the game and render threads
+    core.logger().startAsync();
+
+    TRACE_THREAD_NAME("main");
+
+    bool pipelined = false;
+    DisplayMode display_mode = DISPLAY_WINDOW;
+    uint64_t max_ticks = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--pipelined") == 0)
+        {
+            pipelined = true;
+        }
+        else if(strcmp(argv[i], "--headless") == 0)
+        {
+            display_mode = DISPLAY_NONE;
+        }
+        else if(strcmp(argv[i], "--offscreen") == 0)
+        {
+            display_mode = DISPLAY_OFFSCREEN;
+        }
+        else if(strncmp(argv[i], "--record=", 9) == 0)
+        {
+            if(input_journal.startRecording(argv[i] + 9) != OK)
+            {
+                fprintf(stderr, "%s: %s\n", argv[i] + 9, ERRORMSG(ERROR_OPENING_FILE).c_str());
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strncmp(argv[i], "--replay=", 9) == 0)
+        {
+            ErrorCode ret = input_journal.startReplay(argv[i] + 9);
+            if(ret != OK)
+            {
+                fprintf(stderr, "%s: %s\n", argv[i] + 9, ERRORMSG(ret).c_str());
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strncmp(argv[i], "--ticks=", 8) == 0)
+        {
+            max_ticks = strtoull(argv[i] + 8, NULL, 10);
+        }
+        else if(strncmp(argv[i], "--trace=", 8) == 0)
+        {
+            trace_filename = argv[i] + 8;
+            Tracer::instance().start();
+        }
+        else if(strncmp(argv[i], "--metrics-socket=", 17) == 0)
+        {
+            //scraped with e.g. socat - UNIX-CONNECT:<path>
+            if(core.metrics().startServer(argv[i] + 17) != OK)
+            {
+                fprintf(stderr, "%s: %s\n", argv[i] + 17, ERRORMSG(ERROR_OPENING_FILE).c_str());
+            }
+        }
+        else if(strncmp(argv[i], "--binary-log=", 13) == 0)
+        {
+            //all levels stay cheap enough to keep, see storyofanerd_logdecoder
+            if(core.logger().startBinary(argv[i] + 13) != OK)
+            {
+                fprintf(stderr, "%s: %s\n", argv[i] + 13, ERRORMSG(ERROR_OPENING_FILE).c_str());
+            }
+        }
+    }
+
+    GraphicsCore &gcore = GraphicsCore::instance();
+    if(gcore.initializeWindow(display_mode) != OK ||
+       gcore.initializeRenderer() != OK)
+    {
+        return EXIT_FAILURE;
+    }
+
+    Objecthandler &handler = Objecthandler::instance();
 
+    Inputhandler &input = Inputhandler::instance();
+    UNUSED(input);
+
+    //the map is parsed in the background while the window is already up
+    AsyncMapLoader map_loader;
+    map_loader.start("../res/maps/testmap.tmx");
 
-		endTicks = SDL_GetTicks();
-		deltaMs = endTicks - startTicks;
-		if (deltaMs < MAX_DELTA_MS) {
-			SDL_Delay(MAX_DELTA_MS - deltaMs);
-			deltaMs = MAX_DELTA_MS;
-		}
-		Logger.logMessage(LOG_WARNING,LOG_CORE, "DELTA: %u\n", deltaMs);
+    shared_ptr<Player> player(new Player("../res/player.bmp", 20, 300));
+
+    handler.addGameObject(player);
+
+    if(display_mode != DISPLAY_WINDOW)
+    {
+        runHeadless(map_loader, player, max_ticks);
+    }
+    else if(pipelined == true)
+    {
+        runPipelined(map_loader, player);
+    }
+    else
+    {
+        runSerial(map_loader, player);
+    }
+
+    writeTrace();
+
+    int exit_code = EXIT_SUCCESS;
+    if(input_journal.isReplaying() == true)
+    {
+        printf("replay: %llu of %llu ticks verified, %llu diverged\n",
+               static_cast<unsigned long long>(input_journal.getVerifiedCount()),
+               static_cast<unsigned long long>(input_journal.getTickCount()),
+               static_cast<unsigned long long>(input_journal.getMismatchCount()));
+        if(input_journal.getMismatchCount() > 0)
+        {
+            exit_code = EXIT_FAILURE;
+        }
     }
+    input_journal.close();
 
-stop:
-    return 0;
+    return exit_code;
 }
@@ -0,0 +1,157 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "maploader.h"
+#include "trace.h"
+
+//share of the progress bar taken by parsing, the rest is the image
+static const float PARSE_PROGRESS_SHARE = 0.8f;
+
+///////////////////////////////////////////////////////////////////////////
+
+AsyncMapLoader::AsyncMapLoader() :
+    m_state(STATE_IDLE),
+    m_image_loaded(false),
+    m_result(OK)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+AsyncMapLoader::~AsyncMapLoader()
+{
+    if(m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode AsyncMapLoader::start(const string &filename)
+{
+    if(isBusy() == true)
+    {
+        LOGMESSAGE(LOG_WARNING, LOG_MAP, "AsyncMapLoader::start: "
+                          "Still loading, ignoring %s\n", filename.c_str());
+        return ERROR_UNKNOWN;
+    }
+
+    //the previous worker has finished, but has to be joined
+    if(m_worker.joinable())
+    {
+        m_worker.join();
+    }
+
+    m_map.reset(new LoadedMap(filename));
+    m_tile_set_surface.reset();
+    m_result = OK;
+    m_image_loaded = false;
+    m_state = STATE_LOADING;
+
+    m_worker = std::thread(&AsyncMapLoader::run, this);
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+float AsyncMapLoader::getProgress() const
+{
+    int state = m_state.load();
+    if(state == STATE_IDLE)
+    {
+        return 0.0f;
+    }
+    if(state == STATE_DONE || m_image_loaded.load() == true)
+    {
+        return 1.0f;
+    }
+
+    //m_map is only replaced in start(), never while loading
+    return m_map->getLoadProgress() * PARSE_PROGRESS_SHARE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void AsyncMapLoader::run()
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "AsyncMapLoader::run start\n");
+    TRACE_THREAD_NAME("map loader");
+    TRACE_ZONE("AsyncMapLoader::run");
+
+    m_result = m_map->loadFile();
+    if(m_result == OK)
+    {
+        m_tile_set_surface = ClippedMap::loadTileSetSurface(*m_map);
+        if(m_tile_set_surface.get() == NULL)
+        {
+            m_result = ERROR_FILE_NOT_FOUND;
+        }
+        m_image_loaded = true;
+    }
+
+    //publishes everything written above to poll()
+    m_state.store(STATE_DONE);
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "AsyncMapLoader::run end\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+shared_ptr<ClippedMap> AsyncMapLoader::poll(ErrorCode *result)
+{
+    if(m_state.load() != STATE_DONE)
+    {
+        return shared_ptr<ClippedMap>();
+    }
+
+    m_worker.join();
+
+    shared_ptr<ClippedMap> loaded;
+    if(m_result == OK)
+    {
+        //texture upload has to happen on the render thread
+        loaded.reset(new ClippedMap(m_map, m_tile_set_surface));
+    }
+    else
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "AsyncMapLoader::poll: "
+                          "Loading %s failed (%s)\n", m_map->getFilename().c_str(),
+                          ERRORMSG(m_result).c_str());
+    }
+
+    if(result != NULL)
+    {
+        *result = m_result;
+    }
+
+    m_map.reset();
+    m_tile_set_surface.reset();
+    m_state = STATE_IDLE;
+    return loaded;
+}
+
+///////////////////////////////////////////////////////////////////////////
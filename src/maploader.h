@@ -0,0 +1,94 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <thread>
+#include <string>
+
+#include "core.h"
+#include "xmlloader.h"
+#include "clippedmap.h"
+
+using std::string;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Loads maps on a worker thread
+//!
+//! Parsing, layer decoding and loading the tileset image happen in the
+//! background. poll() is meant to be called once per frame on the render
+//! thread, it only uploads the tileset texture and hands out the finished
+//! map, which can then be swapped into the scene before the next frame.
+class AsyncMapLoader
+{
+    DISABLECOPY(AsyncMapLoader);
+
+    public:
+        AsyncMapLoader();
+        ~AsyncMapLoader();
+
+        //! starts loading filename, fails if a load is still in flight
+        ErrorCode start(const string &filename);
+
+        //! progress of the current load (0.0 - 1.0)
+        float getProgress() const;
+
+        inline bool isBusy() const
+        {
+            return m_state.load() != STATE_IDLE;
+        }
+
+        //! returns the built map once the worker is done, NULL before;
+        //! result (optional) receives the error of failed loads
+        shared_ptr<ClippedMap> poll(ErrorCode *result = NULL);
+
+    private:
+        enum State
+        {
+            STATE_IDLE,
+            STATE_LOADING,
+            STATE_DONE
+        };
+
+        void run();
+
+        std::thread             m_worker;
+        std::atomic<int>        m_state;
+        std::atomic<bool>       m_image_loaded;
+
+        //only touched by the worker while STATE_LOADING
+        shared_ptr<LoadedMap>   m_map;
+        shared_ptr<SDL_Surface> m_tile_set_surface;
+        ErrorCode               m_result;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,95 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mappedfile.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile() :
+    m_data(NULL),
+    m_size(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode MappedFile::open(const string &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return ERROR_FILE_NOT_FOUND;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        ::close(fd);
+        return ERROR_OPENING_FILE;
+    }
+
+    void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    //the mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if(data == MAP_FAILED)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    m_data = static_cast<const char*>(data);
+    m_size = info.st_size;
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MappedFile::close()
+{
+    if(m_data != NULL)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+        m_data = NULL;
+        m_size = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,74 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stddef.h>
+#include <string>
+
+#include "common.h"
+#include "errorcodes.h"
+
+using std::string;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! read-only memory mapping of a whole file
+class MappedFile
+{
+    DISABLECOPY(MappedFile);
+
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        ErrorCode open(const string &filename);
+        void close();
+
+        inline bool isOpen() const
+        {
+            return m_data != NULL;
+        }
+
+        inline const char* getData() const
+        {
+            return m_data;
+        }
+
+        inline size_t getSize() const
+        {
+            return m_size;
+        }
+
+    private:
+        const char  *m_data;
+        size_t      m_size;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,406 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <new>
+
+#include "metrics.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//plain atomics, operator new runs long before any constructor
+static std::atomic<uint64_t> allocated_bytes(0);
+static std::atomic<uint64_t> allocation_count(0);
+
+///////////////////////////////////////////////////////////////////////////
+
+//none of these are inlined, gcc would see free() of memory from malloc
+//through operator new and fail optimized builds (-Wmismatched-new-delete)
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    void *memory = malloc(size == 0 ? 1 : size);
+    if(memory == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+__attribute__((noinline)) void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t getAllocatedBytes()
+{
+    return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t getAllocationCount()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricHistogram::MetricHistogram() :
+    m_count(0), m_max(0)
+{
+    for(uint i = 0; i < BUCKET_COUNT; i++)
+    {
+        m_buckets[i] = 0;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint MetricHistogram::getBucket(uint64_t value)
+{
+    if(value < 2 * SUB_BUCKETS)
+    {
+        return value;
+    }
+
+    //the top SUB_BUCKET_BITS + 1 bits pick the bucket
+    uint msb = 63 - __builtin_clzll(value);
+    uint shift = msb - SUB_BUCKET_BITS;
+    uint sub_bucket = (value >> shift) - SUB_BUCKETS;
+    return (shift + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t MetricHistogram::getBucketMax(uint bucket)
+{
+    if(bucket < 2 * SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    uint shift = bucket / SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MetricHistogram::record(uint64_t value)
+{
+    m_buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while(value > max &&
+          m_max.compare_exchange_weak(max, value, std::memory_order_relaxed) == false)
+    {
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t MetricHistogram::getCount() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t MetricHistogram::getMax() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t MetricHistogram::getPercentile(double percentile) const
+{
+    //buckets are summed up instead of trusting m_count, recording may be
+    //going on while we read
+    uint64_t total = 0;
+    for(uint i = 0; i < BUCKET_COUNT; i++)
+    {
+        total += m_buckets[i].load(std::memory_order_relaxed);
+    }
+
+    if(total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * total + 0.5);
+    if(rank == 0)
+    {
+        rank = 1;
+    }
+    if(rank > total)
+    {
+        rank = total;
+    }
+
+    uint64_t seen = 0;
+    for(uint i = 0; i < BUCKET_COUNT; i++)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if(seen >= rank)
+        {
+            uint64_t value = getBucketMax(i);
+            uint64_t max = getMax();
+            return (value < max) ? value : max;
+        }
+    }
+
+    return getMax();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricsRegistry::MetricsRegistry() :
+    m_socket(-1), m_stop_server(false)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricsRegistry::~MetricsRegistry()
+{
+    stopServer();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricCounter& MetricsRegistry::counter(const string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    unique_ptr<MetricCounter> &metric = m_counters[name];
+    if(metric.get() == NULL)
+    {
+        metric.reset(new MetricCounter());
+    }
+    return *metric;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricGauge& MetricsRegistry::gauge(const string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    unique_ptr<MetricGauge> &metric = m_gauges[name];
+    if(metric.get() == NULL)
+    {
+        metric.reset(new MetricGauge());
+    }
+    return *metric;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MetricHistogram& MetricsRegistry::histogram(const string &name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    unique_ptr<MetricHistogram> &metric = m_histograms[name];
+    if(metric.get() == NULL)
+    {
+        metric.reset(new MetricHistogram());
+    }
+    return *metric;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MetricsRegistry::writeStats(FILE *stream)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for(map<string, unique_ptr<MetricCounter> >::const_iterator it = m_counters.begin();
+        it != m_counters.end(); ++it)
+    {
+        fprintf(stream, "%s %llu\n", it->first.c_str(),
+                static_cast<unsigned long long>(it->second->get()));
+    }
+
+    for(map<string, unique_ptr<MetricGauge> >::const_iterator it = m_gauges.begin();
+        it != m_gauges.end(); ++it)
+    {
+        fprintf(stream, "%s %lld\n", it->first.c_str(),
+                static_cast<long long>(it->second->get()));
+    }
+
+    for(map<string, unique_ptr<MetricHistogram> >::const_iterator it = m_histograms.begin();
+        it != m_histograms.end(); ++it)
+    {
+        const char *name = it->first.c_str();
+        const MetricHistogram &histogram = *it->second;
+
+        fprintf(stream, "%s_p50 %llu\n", name,
+                static_cast<unsigned long long>(histogram.getPercentile(50.0)));
+        fprintf(stream, "%s_p99 %llu\n", name,
+                static_cast<unsigned long long>(histogram.getPercentile(99.0)));
+        fprintf(stream, "%s_p999 %llu\n", name,
+                static_cast<unsigned long long>(histogram.getPercentile(99.9)));
+        fprintf(stream, "%s_max %llu\n", name,
+                static_cast<unsigned long long>(histogram.getMax()));
+        fprintf(stream, "%s_count %llu\n", name,
+                static_cast<unsigned long long>(histogram.getCount()));
+    }
+
+    fprintf(stream, "allocated_bytes %llu\n",
+            static_cast<unsigned long long>(getAllocatedBytes()));
+    fprintf(stream, "allocations %llu\n",
+            static_cast<unsigned long long>(getAllocationCount()));
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode MetricsRegistry::startServer(const string &path)
+{
+    stopServer();
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+    {
+        return ERROR_OPENING_FILE;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(m_socket < 0)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    //a stale socket of an earlier run would make bind fail
+    unlink(path.c_str());
+
+    if(bind(m_socket, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+       listen(m_socket, 4) != 0)
+    {
+        close(m_socket);
+        m_socket = -1;
+        return ERROR_OPENING_FILE;
+    }
+
+    m_socket_path = path;
+    m_stop_server = false;
+    m_server = std::thread(&MetricsRegistry::runServer, this);
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MetricsRegistry::stopServer()
+{
+    if(m_socket < 0)
+    {
+        return;
+    }
+
+    m_stop_server = true;
+    m_server.join();
+
+    close(m_socket);
+    m_socket = -1;
+    unlink(m_socket_path.c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MetricsRegistry::runServer()
+{
+    struct pollfd listener;
+    listener.fd = m_socket;
+    listener.events = POLLIN;
+
+    while(m_stop_server.load() == false)
+    {
+        //wakes up now and then to notice stopServer
+        if(poll(&listener, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        int client = accept(m_socket, NULL, NULL);
+        if(client < 0)
+        {
+            continue;
+        }
+
+        //formatted into memory first, a slow client must not hold m_mutex
+        char *text = NULL;
+        size_t size = 0;
+        FILE *stream = open_memstream(&text, &size);
+        if(stream != NULL)
+        {
+            writeStats(stream);
+            fclose(stream);
+
+            size_t written = 0;
+            while(written < size)
+            {
+                ssize_t ret = send(client, text + written, size - written, MSG_NOSIGNAL);
+                if(ret < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if(ret <= 0)
+                {
+                    break;
+                }
+                written += ret;
+            }
+            free(text);
+        }
+
+        close(client);
+    }
+}
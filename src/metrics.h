@@ -0,0 +1,181 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common.h"
+#include "errorcodes.h"
+
+using std::map;
+using std::string;
+using std::unique_ptr;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! only goes up, scrapers compute rates themselves
+class MetricCounter
+{
+    public:
+        MetricCounter() :
+            m_value(0)
+        {
+        }
+
+        inline void add(uint64_t amount = 1)
+        {
+            m_value.fetch_add(amount, std::memory_order_relaxed);
+        }
+
+        inline uint64_t get() const
+        {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<uint64_t> m_value;
+
+        DISABLECOPY(MetricCounter);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! last value set
+class MetricGauge
+{
+    public:
+        MetricGauge() :
+            m_value(0)
+        {
+        }
+
+        inline void set(int64_t value)
+        {
+            m_value.store(value, std::memory_order_relaxed);
+        }
+
+        inline int64_t get() const
+        {
+            return m_value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<int64_t> m_value;
+
+        DISABLECOPY(MetricGauge);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! HDR style histogram: exact below 2 * SUB_BUCKETS, above that every
+//! power of two is split into SUB_BUCKETS linear buckets, so any value
+//! is off by at most 1 / SUB_BUCKETS (about 3%). Recording is lock-free.
+class MetricHistogram
+{
+    public:
+        MetricHistogram();
+
+        void record(uint64_t value);
+
+        uint64_t getCount() const;
+        uint64_t getMax() const;
+
+        //! percentile in [0, 100], highest value of the matching bucket
+        uint64_t getPercentile(double percentile) const;
+
+    private:
+        static const uint SUB_BUCKET_BITS = 5;
+        static const uint SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+        static const uint BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+        static uint getBucket(uint64_t value);
+        static uint64_t getBucketMax(uint bucket);
+
+        std::atomic<uint64_t> m_buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> m_count;
+        std::atomic<uint64_t> m_max;
+
+        DISABLECOPY(MetricHistogram);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Named metrics of the running game. Lookups lock, keep the reference:
+//!     static MetricCounter &tests = GameCore::instance().metrics().counter("...");
+//! References stay valid as long as the registry lives.
+class MetricsRegistry
+{
+    public:
+        MetricsRegistry();
+        ~MetricsRegistry();
+
+        MetricCounter& counter(const string &name);
+        MetricGauge& gauge(const string &name);
+        MetricHistogram& histogram(const string &name);
+
+        //! one "name value" line per value, histograms as p50/p99/p999,
+        //! count and max, plus the allocation counters
+        void writeStats(FILE *stream);
+
+        //! serves writeStats to every client connecting to a UNIX domain
+        //! socket at path, e.g. socat - UNIX-CONNECT:<path>
+        ErrorCode startServer(const string &path);
+        void stopServer();
+
+    private:
+        void runServer();
+
+        std::mutex      m_mutex;
+        map<string, unique_ptr<MetricCounter> >     m_counters;
+        map<string, unique_ptr<MetricGauge> >       m_gauges;
+        map<string, unique_ptr<MetricHistogram> >   m_histograms;
+
+        string          m_socket_path;
+        int             m_socket;
+        std::thread     m_server;
+        std::atomic<bool>   m_stop_server;
+
+        DISABLECOPY(MetricsRegistry);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! counted by the global operator new of the game, see metrics.cpp
+uint64_t getAllocatedBytes();
+uint64_t getAllocationCount();
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -29,10 +29,14 @@
 
 #include <SDL2/SDL.h>
 #include <vector>
+#include <algorithm>
 
 #include "core.h"
 #include "common.h"
 #include "gameobject.h"
+#include "aabbtree.h"
+#include "sweep.h"
+#include "trace.h"
 
 using std::vector;
 
@@ -62,53 +66,375 @@ class Objecthandler
 
         void updateAll()
         {
+            TRACE_ZONE("Objecthandler::updateAll");
+            static MetricCounter &objects_updated = GameCore::instance().metrics().counter("objects_updated");
+
             for(uint i = 0; i < m_game_objects.size(); i++)
             {
                 m_game_objects.at(i).get()->update();
             }
+            objects_updated.add(m_game_objects.size());
         }
 
-        void drawAll()
+        void drawAll(float alpha)
         {
+            TRACE_ZONE("Objecthandler::drawAll");
             for(uint i = 0; i < m_game_objects.size(); i++)
             {
-                m_game_objects.at(i).get()->drawAll();
+                m_game_objects.at(i).get()->drawAll(alpha);
             }
         }
 
         void addGameObject(shared_ptr<GameObject> object)
         {
             m_game_objects.push_back(object);
+            attachGameObject(object.get());
         }
 
-        bool checkCollision(const GameObject &object)
+        //! objects are updated and drawn in order, 0 is drawn first
+        void insertGameObject(uint position, shared_ptr<GameObject> object)
+        {
+            if(position > m_game_objects.size())
+            {
+                position = m_game_objects.size();
+            }
+            m_game_objects.insert(m_game_objects.begin() + position, object);
+            attachGameObject(object.get());
+        }
+
+        //! swaps old_object for new_object, keeping its update/draw position
+        void replaceGameObject(shared_ptr<GameObject> old_object, shared_ptr<GameObject> new_object)
         {
             for(uint i = 0; i < m_game_objects.size(); i++)
             {
-                //Cant collide with ourselves
-                if(object == *(m_game_objects.at(i).get()))
+                if(m_game_objects.at(i) == old_object)
                 {
-                    continue;
+                    detachGameObject(old_object.get());
+                    m_game_objects.at(i) = new_object;
+                    attachGameObject(new_object.get());
+                    return;
                 }
+            }
 
-                if(object.checkCollision(*(m_game_objects.at(i).get())) == true)
+            addGameObject(new_object);
+        }
+
+        void removeGameObject(shared_ptr<GameObject> object)
+        {
+            for(uint i = 0; i < m_game_objects.size(); i++)
+            {
+                if(m_game_objects.at(i) == object)
                 {
-                    return true;
+                    detachGameObject(object.get());
+                    m_game_objects.erase(m_game_objects.begin() + i);
+                    return;
+                }
+            }
+        }
+
+        //! hash of everything simulated, in update order
+        uint32_t getStateChecksum() const
+        {
+            uint32_t hash = FNV_OFFSET_BASIS;
+            for(uint i = 0; i < m_game_objects.size(); i++)
+            {
+                hash = m_game_objects.at(i).get()->hashState(hash);
+            }
+            return hash;
+        }
+
+        //! only graphics objects whose tree boxes overlap object are tested
+        bool checkCollision(const GameObject &object)
+        {
+            TRACE_ZONE("Objecthandler::checkCollision");
+            static MetricCounter &pair_tests = GameCore::instance().metrics().counter("collision_pair_tests");
+
+            if(object.hasCollisionEnabled() == false)
+            {
+                return false;
+            }
+
+            //counted locally, one atomic add per call
+            uint tests = 0;
+
+            const vector<shared_ptr <GraphicsObject> > &own_objects = object.getGraphicsObjects();
+            for(uint i = 0; i < own_objects.size(); i++)
+            {
+                GraphicsObject *own = own_objects.at(i).get();
+
+                for(uint j = 0; j < m_area_colliders.size(); j++)
+                {
+                    GameObject *collider = m_area_colliders[j];
+                    if(collider == &object || collider->hasCollisionEnabled() == false)
+                    {
+                        continue;
+                    }
+
+                    tests++;
+                    if(collider->checkAreaCollision(*(own->getDst().get())) == true)
+                    {
+                        pair_tests.add(tests);
+                        return true;
+                    }
+                }
+
+                m_collision_candidates.clear();
+                m_broadphase.query(*(own->getDst().get()), m_collision_candidates);
+
+                for(uint j = 0; j < m_collision_candidates.size(); j++)
+                {
+                    GraphicsObject *candidate = m_collision_candidates[j];
+                    GameObject *owner = candidate->getOwner();
+
+                    //Cant collide with ourselves
+                    if(owner == NULL || owner == &object ||
+                       owner->hasCollisionEnabled() == false)
+                    {
+                        continue;
+                    }
+
+                    tests++;
+                    if(own->hasCollision(*candidate) == true)
+                    {
+                        pair_tests.add(tests);
+                        return true;
+                    }
                 }
             }
 
+            pair_tests.add(tests);
             return false;
         }
 
+        //! appends the objects with a graphics object overlapping area,
+        //! area colliders (the map) are not included
+        void queryArea(const SDL_Rect &area, vector<GameObject*> &result)
+        {
+            m_collision_candidates.clear();
+            m_broadphase.query(area, m_collision_candidates);
+
+            for(uint i = 0; i < m_collision_candidates.size(); i++)
+            {
+                GraphicsObject *candidate = m_collision_candidates[i];
+                GameObject *owner = candidate->getOwner();
+                if(owner == NULL || SDL_HasIntersection(candidate->getDst().get(), &area) == SDL_FALSE)
+                {
+                    continue;
+                }
+
+                if(std::find(result.begin(), result.end(), owner) == result.end())
+                {
+                    result.push_back(owner);
+                }
+            }
+        }
+
+        //! Moves body by dx/dy and slides along whatever it hits instead of
+        //! stopping. Map colliders and other objects near the path are
+        //! gathered once, then the box is swept against them, so fast moves
+        //! cannot pass through thin walls. Returns the first contact, its
+        //! time is relative to the full displacement.
+        SweepHit moveAndSlide(GraphicsObject &body, int dx, int dy)
+        {
+            TRACE_ZONE("Objecthandler::moveAndSlide");
+
+            SDL_Rect box = *(body.getDst().get());
+            GameObject *owner = body.getOwner();
+
+            m_sweep_obstacles.clear();
+            if(owner == NULL || owner->hasCollisionEnabled() == true)
+            {
+                gatherObstacles(getSweptBounds(box, dx, dy), owner);
+            }
+
+            SweepHit first_hit;
+            int remaining_x = dx;
+            int remaining_y = dy;
+            for(uint slide = 0; slide < MAX_SLIDES; slide++)
+            {
+                if(remaining_x == 0 && remaining_y == 0)
+                {
+                    break;
+                }
+
+                SweepHit hit;
+                uint hit_index = 0;
+                for(uint i = 0; i < m_sweep_obstacles.size(); i++)
+                {
+                    SweepHit candidate;
+                    if(sweepAABB(box, remaining_x, remaining_y, m_sweep_obstacles[i], &candidate) == true &&
+                       candidate.time < hit.time)
+                    {
+                        hit = candidate;
+                        hit_index = i;
+                    }
+                }
+
+                if(hit.hasHit() == false)
+                {
+                    box.x += remaining_x;
+                    box.y += remaining_y;
+                    break;
+                }
+
+                //the hit axis stops exactly at the surface, the other one is
+                //rounded towards the start so the box never ends up inside
+                const SDL_Rect &obstacle = m_sweep_obstacles[hit_index];
+                int step_x = static_cast<int>(remaining_x * hit.time);
+                int step_y = static_cast<int>(remaining_y * hit.time);
+                if(hit.normal_x > 0)
+                {
+                    step_x = obstacle.x + obstacle.w - box.x;
+                }
+                else if(hit.normal_x < 0)
+                {
+                    step_x = obstacle.x - (box.x + box.w);
+                }
+                else if(hit.normal_y > 0)
+                {
+                    step_y = obstacle.y + obstacle.h - box.y;
+                }
+                else
+                {
+                    step_y = obstacle.y - (box.y + box.h);
+                }
+
+                SDL_Rect moved = box;
+                moved.x += step_x;
+                moved.y += step_y;
+                if(overlapsNewObstacle(box, moved) == true)
+                {
+                    step_x = 0;
+                    step_y = 0;
+                }
+                box.x += step_x;
+                box.y += step_y;
+
+                if(first_hit.hasHit() == false)
+                {
+                    //progress along the blocked axis over the whole move
+                    first_hit = hit;
+                    if(hit.normal_x != 0)
+                    {
+                        first_hit.time = static_cast<float>(dx - remaining_x + step_x) / dx;
+                    }
+                    else
+                    {
+                        first_hit.time = static_cast<float>(dy - remaining_y + step_y) / dy;
+                    }
+                }
+
+                //keep only the part along the surface
+                remaining_x = hit.normal_x != 0 ? 0 : remaining_x - step_x;
+                remaining_y = hit.normal_y != 0 ? 0 : remaining_y - step_y;
+            }
+
+            body.setX(box.x);
+            body.setY(box.y);
+            return first_hit;
+        }
+
+        //! first object hit by the segment from x0/y0 to x1/y1 (NULL if none)
+        GameObject* raycast(float x0, float y0, float x1, float y1, float *fraction = NULL) const
+        {
+            GraphicsObject *hit = m_broadphase.raycast(x0, y0, x1, y1, fraction);
+            return hit != NULL ? hit->getOwner() : NULL;
+        }
+
     private:
         Objecthandler()
         {
         };
         virtual ~Objecthandler()
         {
+            //the tree is destroyed before the objects, detach them first
+            for(uint i = 0; i < m_game_objects.size(); i++)
+            {
+                m_game_objects.at(i).get()->setBroadphase(NULL);
+            }
         };
 
+        //! rects of the map and of other objects with collision near bounds
+        void gatherObstacles(const SDL_Rect &bounds, const GameObject *owner)
+        {
+            for(uint i = 0; i < m_area_colliders.size(); i++)
+            {
+                GameObject *collider = m_area_colliders[i];
+                if(collider != owner && collider->hasCollisionEnabled() == true)
+                {
+                    collider->queryAreaColliders(bounds, m_sweep_obstacles);
+                }
+            }
+
+            m_collision_candidates.clear();
+            m_broadphase.query(bounds, m_collision_candidates);
+            for(uint i = 0; i < m_collision_candidates.size(); i++)
+            {
+                GraphicsObject *candidate = m_collision_candidates[i];
+                GameObject *candidate_owner = candidate->getOwner();
+                if(candidate_owner == NULL || candidate_owner == owner ||
+                   candidate_owner->hasCollisionEnabled() == false)
+                {
+                    continue;
+                }
+
+                const SDL_Rect *dst = candidate->getDst().get();
+                if(SDL_HasIntersection(dst, &bounds) == SDL_TRUE)
+                {
+                    m_sweep_obstacles.push_back(*dst);
+                }
+            }
+        }
+
+        //! true if moved overlaps an obstacle that box did not overlap yet
+        bool overlapsNewObstacle(const SDL_Rect &box, const SDL_Rect &moved) const
+        {
+            for(uint i = 0; i < m_sweep_obstacles.size(); i++)
+            {
+                const SDL_Rect *obstacle = &m_sweep_obstacles[i];
+                if(SDL_HasIntersection(&moved, obstacle) == SDL_TRUE &&
+                   SDL_HasIntersection(&box, obstacle) == SDL_FALSE)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void attachGameObject(GameObject *object)
+        {
+            object->setBroadphase(&m_broadphase);
+
+            if(object->usesAreaCollision() == true)
+            {
+                m_area_colliders.push_back(object);
+            }
+        }
+
+        void detachGameObject(GameObject *object)
+        {
+            object->setBroadphase(NULL);
+
+            for(uint i = 0; i < m_area_colliders.size(); i++)
+            {
+                if(m_area_colliders[i] == object)
+                {
+                    m_area_colliders.erase(m_area_colliders.begin() + i);
+                    break;
+                }
+            }
+        }
+
         vector<shared_ptr <GameObject> > m_game_objects;
+        vector<GameObject*> m_area_colliders;
+
+        AABBTree m_broadphase;
+        vector<GraphicsObject*> m_collision_candidates;
+        vector<SDL_Rect> m_sweep_obstacles;
+
+        //! a move hits at most one wall per axis, the last slide only
+        //! catches a corner in between
+        static const uint MAX_SLIDES = 3;
 
         DISABLECOPY(Objecthandler);
 };
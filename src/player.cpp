@@ -33,10 +33,14 @@ Player::Player(const string &bmpfile, uint position_x, uint position_y) :
     GameObject("Player"),
     m_position_x(position_x),
     m_position_y(position_y),
-    m_next_position_x(position_x),
-    m_next_position_y(position_y)
+    m_previous_position_x(position_x),
+    m_previous_position_y(position_y),
+    m_moving_left(false),
+    m_moving_right(false),
+    m_moving_up(false),
+    m_moving_down(false)
 {
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::Player start\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::Player start\n");
 
     shared_ptr<SDL_Texture> texture(GraphicsCore::instance().createTextureFromBMP(bmpfile),
                                     SDL_DestroyTexture);
@@ -45,76 +49,116 @@ Player::Player(const string &bmpfile, uint position_x, uint position_y) :
 
     this->addGraphicsObject(playergraphics);
 
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::Player end\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::Player end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 Player::~Player()
 {
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::~Player\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::~Player\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void Player::update()
 {
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::update start\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::update start\n");
 
-    m_graphics_objects.at(0).get()->setX(m_next_position_x);
-    m_graphics_objects.at(0).get()->setY(m_next_position_y);
+    m_previous_position_x = m_position_x;
+    m_previous_position_y = m_position_y;
 
-    bool has_collision = Scene.checkCollision(*this);
+    //constant speed per tick, independent of frame rate and key repeat
+    int velocity_x = (m_moving_right ? PLAYER_SPEED : 0) - (m_moving_left ? PLAYER_SPEED : 0);
+    int velocity_y = (m_moving_down ? PLAYER_SPEED : 0) - (m_moving_up ? PLAYER_SPEED : 0);
 
-    if(has_collision == true)
-    {
-        Logger.logMessage(LOG_DEBUG2, LOG_PLAYER, "Player::update: Collided, resetting x/y.\n");
-
-        //Don't update, reset position
-        m_graphics_objects.at(0).get()->setX(m_position_x);
-        m_graphics_objects.at(0).get()->setY(m_position_y);
+    //walls stop the player at their surface, the rest of the move slides along
+    GraphicsObject *body = m_graphics_objects.at(0).get();
+    SweepHit hit = Scene.moveAndSlide(*body, velocity_x, velocity_y);
 
-        m_next_position_x = m_position_x;
-        m_next_position_y = m_position_y;
+    if(hit.hasHit() == true)
+    {
+        LOGMESSAGE(LOG_DEBUG2, LOG_PLAYER, "Player::update: Collided at %f, normal %d/%d.\n",
+                   hit.time, hit.normal_x, hit.normal_y);
     }
     else
     {
-        Logger.logMessage(LOG_DEBUG2, LOG_PLAYER, "Player::update: Did not collide with anything!\n");
-        m_position_x = m_next_position_x;
-        m_position_y = m_next_position_y;
+        LOGMESSAGE(LOG_DEBUG2, LOG_PLAYER, "Player::update: Did not collide with anything!\n");
     }
 
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::update end\n");
+    m_position_x = body->getX();
+    m_position_y = body->getY();
+
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::update end\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Player::drawAll(float alpha)
+{
+    //m_position is the last simulated state, blend from the one before
+    int x = m_previous_position_x +
+            static_cast<int>((static_cast<int>(m_position_x) - static_cast<int>(m_previous_position_x)) * alpha);
+    int y = m_previous_position_y +
+            static_cast<int>((static_cast<int>(m_position_y) - static_cast<int>(m_previous_position_y)) * alpha);
+
+    m_graphics_objects.at(0).get()->drawObjectAt(x, y, m_render_layer, m_draw_order);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 bool Player::handleKeyEvent(const InputEvent &event)
 {
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::handleKeyEvent start\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::handleKeyEvent start\n");
 
     assert(event);
 
     switch(event)
     {
         case PLAYER_RIGHT:
-            m_next_position_x = m_next_position_x + 10;
+            m_moving_right = true;
             return true;
         case PLAYER_LEFT:
-            m_next_position_x = m_next_position_x - 10;
+            m_moving_left = true;
             return true;
         case PLAYER_DOWN:
-            m_next_position_y = m_next_position_y + 10;
+            m_moving_down = true;
             return true;
         case PLAYER_UP:
-            m_next_position_y = m_next_position_y - 10;
+            m_moving_up = true;
+            return true;
+        case PLAYER_RIGHT_RELEASED:
+            m_moving_right = false;
+            return true;
+        case PLAYER_LEFT_RELEASED:
+            m_moving_left = false;
+            return true;
+        case PLAYER_DOWN_RELEASED:
+            m_moving_down = false;
+            return true;
+        case PLAYER_UP_RELEASED:
+            m_moving_up = false;
             return true;
         default:
             break;
     }
 
-    Logger.logMessage(LOG_STATE, LOG_PLAYER, "Player::handleKeyEvent end\n");
+    LOGMESSAGE(LOG_STATE, LOG_PLAYER, "Player::handleKeyEvent end\n");
     return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////
+
+uint32_t Player::hashState(uint32_t hash) const
+{
+    hash = GameObject::hashState(hash);
+
+    hash = hashBytes(hash, &m_position_x, sizeof(m_position_x));
+    hash = hashBytes(hash, &m_position_y, sizeof(m_position_y));
+
+    uint8_t moving = (m_moving_left ? 1 : 0) | (m_moving_right ? 2 : 0) |
+                     (m_moving_up ? 4 : 0) | (m_moving_down ? 8 : 0);
+    return hashBytes(hash, &moving, sizeof(moving));
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -45,14 +45,25 @@ class Player : public GameObject
         virtual ~Player();
 
         virtual void update();
+        virtual void drawAll(float alpha);
         virtual bool handleKeyEvent(const InputEvent &event);
+        virtual uint32_t hashState(uint32_t hash) const;
 
     private:
+        //! pixels per simulation tick while a direction key is held
+        static const int PLAYER_SPEED = 5;
+
         uint m_position_x;
         uint m_position_y;
 
-        uint m_next_position_x;
-        uint m_next_position_y;
+        //position before the last tick, for render interpolation
+        uint m_previous_position_x;
+        uint m_previous_position_y;
+
+        bool m_moving_left;
+        bool m_moving_right;
+        bool m_moving_up;
+        bool m_moving_down;
 
         DISABLECOPY(Player);
 };
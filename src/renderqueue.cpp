@@ -0,0 +1,215 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "renderqueue.h"
+#include "graphics.h"
+
+#include <string.h>
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////
+
+RenderQueue::RenderQueue() :
+    m_sequence(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::push(SDL_Texture *texture, const SDL_Rect *clip, const SDL_Rect &dst,
+                       uint8_t layer, DrawOrder order)
+{
+    assert(texture);
+
+    RenderCommand command;
+    command.texture = texture;
+    command.dst = dst;
+    command.has_clip = (clip != NULL);
+    if(clip != NULL)
+    {
+        command.clip = *clip;
+    }
+    command.callback = NULL;
+    command.context = NULL;
+
+    pushCommand(command, layer, order);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::pushCallback(RenderCallback callback, void *context, SDL_Texture *texture,
+                               const SDL_Rect &dst, uint8_t layer, DrawOrder order)
+{
+    assert(callback);
+
+    RenderCommand command;
+    command.texture = texture;
+    command.dst = dst;
+    command.has_clip = false;
+    command.callback = callback;
+    command.context = context;
+
+    pushCommand(command, layer, order);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::pushCommand(const RenderCommand &command, uint8_t layer, DrawOrder order)
+{
+    uint32_t order_value = 0;
+    switch(order)
+    {
+        case DRAWORDER_TOPDOWN:
+            //bias the signed bottom edge so it sorts as unsigned
+            order_value = static_cast<uint32_t>(command.dst.y + command.dst.h) ^ 0x80000000u;
+            break;
+        case DRAWORDER_INDEX:
+            order_value = m_sequence;
+            break;
+        case DRAWORDER_NONE:
+            break;
+    }
+    m_sequence++;
+
+    SortEntry entry;
+    entry.key = (static_cast<uint64_t>(layer) << KEY_LAYER_SHIFT) |
+                (static_cast<uint64_t>(order_value) << KEY_ORDER_SHIFT) |
+                getTextureId(command.texture);
+    entry.index = m_commands.size();
+
+    m_commands.push_back(command);
+    m_sort_entries.push_back(entry);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint32_t RenderQueue::getTextureId(SDL_Texture *texture)
+{
+    unordered_map<SDL_Texture*, uint32_t>::iterator found = m_texture_ids.find(texture);
+    if(found != m_texture_ids.end())
+    {
+        return found->second;
+    }
+
+    uint32_t id = m_texture_ids.size() & ((1u << KEY_TEXTURE_BITS) - 1);
+    m_texture_ids[texture] = id;
+    return id;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::sortCommands()
+{
+    const size_t count = m_sort_entries.size();
+    if(count < 2)
+    {
+        return;
+    }
+
+    //all eight byte histograms in a single pass
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for(size_t i = 0; i < count; i++)
+    {
+        uint64_t key = m_sort_entries[i].key;
+        for(int byte = 0; byte < 8; byte++)
+        {
+            histograms[byte][(key >> (byte * 8)) & 0xff]++;
+        }
+    }
+
+    m_sort_scratch.resize(count);
+    SortEntry *source = m_sort_entries.data();
+    SortEntry *target = m_sort_scratch.data();
+
+    for(int byte = 0; byte < 8; byte++)
+    {
+        uint32_t *histogram = histograms[byte];
+        const int shift = byte * 8;
+
+        //every key has the same value in this byte, nothing to reorder
+        if(histogram[(source[0].key >> shift) & 0xff] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for(int bucket = 0; bucket < 256; bucket++)
+        {
+            uint32_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+
+        for(size_t i = 0; i < count; i++)
+        {
+            target[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+        }
+
+        std::swap(source, target);
+    }
+
+    if(source != m_sort_entries.data())
+    {
+        m_sort_entries.swap(m_sort_scratch);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::submit()
+{
+    sortCommands();
+
+    GraphicsCore &gcore = GraphicsCore::instance();
+    for(size_t i = 0; i < m_sort_entries.size(); i++)
+    {
+        const RenderCommand &command = m_commands[m_sort_entries[i].index];
+        if(command.callback != NULL)
+        {
+            command.callback(command.context, command);
+            continue;
+        }
+
+        gcore.queueSprite(command.texture, command.has_clip ? &command.clip : NULL,
+                          command.dst);
+    }
+    gcore.flushSprites();
+
+    clear();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void RenderQueue::clear()
+{
+    m_commands.clear();
+    m_sort_entries.clear();
+    m_texture_ids.clear();
+    m_sequence = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,145 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "common.h"
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! how commands inside one layer are ordered (see TMX draworder)
+enum DrawOrder
+{
+    //! no overlap (tile layers), grouped by texture only
+    DRAWORDER_NONE,
+    //! by the bottom edge of the destination, lower on screen is in front
+    DRAWORDER_TOPDOWN,
+    //! in the order the commands were recorded
+    DRAWORDER_INDEX
+};
+
+//! render layers used by the game, lower layers are drawn first
+static const uint8_t RENDER_LAYER_MAP     = 0;
+static const uint8_t RENDER_LAYER_OBJECTS = 1;
+
+//! maps the draworder attribute of an objectgroup, Tiled defaults to topdown
+inline DrawOrder drawOrderFromString(const string &draworder)
+{
+    return (draworder == "index") ? DRAWORDER_INDEX : DRAWORDER_TOPDOWN;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+struct RenderCommand;
+
+//! runs on the render thread at the command's place in the sorted queue
+typedef void (*RenderCallback)(void *context, const RenderCommand &command);
+
+//! one recorded sprite, POD so the buffer is reused without allocations
+struct RenderCommand
+{
+    SDL_Texture *texture;
+    SDL_Rect    clip;
+    SDL_Rect    dst;
+    bool        has_clip;
+
+    //set for callback commands, texture/clip/dst are free for its use then
+    RenderCallback callback;
+    void        *context;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Per frame command buffer
+//!
+//! Commands are recorded during drawAll and sorted by a 64 bit key
+//! (layer | order | texture) with a stable LSD radix sort before they
+//! are handed to the sprite batcher in one pass. Equal keys keep their
+//! recording order, so the result is deterministic.
+class RenderQueue
+{
+    DISABLECOPY(RenderQueue);
+
+    public:
+        RenderQueue();
+
+        void push(SDL_Texture *texture, const SDL_Rect *clip, const SDL_Rect &dst,
+                  uint8_t layer, DrawOrder order);
+
+        //! for drawing that needs the renderer itself (e.g. baking render
+        //! targets), context has to outlive the submission of this frame
+        void pushCallback(RenderCallback callback, void *context, SDL_Texture *texture,
+                          const SDL_Rect &dst, uint8_t layer, DrawOrder order);
+
+        //! sorts and draws all recorded commands, then clears the queue
+        void submit();
+
+        void clear();
+
+        inline uint getCommandCount() const
+        {
+            return m_commands.size();
+        }
+
+    private:
+        struct SortEntry
+        {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        //key layout: layer (8) | order (32) | texture (24)
+        static const int KEY_TEXTURE_BITS = 24;
+        static const int KEY_ORDER_SHIFT  = 24;
+        static const int KEY_LAYER_SHIFT  = 56;
+
+        void pushCommand(const RenderCommand &command, uint8_t layer, DrawOrder order);
+        uint32_t getTextureId(SDL_Texture *texture);
+        void sortCommands();
+
+        vector<RenderCommand> m_commands;
+        vector<SortEntry> m_sort_entries;
+        vector<SortEntry> m_sort_scratch;
+
+        //textures are numbered in order of first use each frame
+        unordered_map<SDL_Texture*, uint32_t> m_texture_ids;
+        uint32_t m_sequence;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,118 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "sweep.h"
+
+#include <limits>
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////
+
+//entry and exit time of one axis, gaps are measured in move direction
+static bool sweepAxis(int position, int size, int delta,
+                      int target_position, int target_size,
+                      float *entry, float *exit)
+{
+    if(delta == 0)
+    {
+        //standing still on this axis, it has to overlap the whole move
+        if(position < target_position + target_size &&
+           target_position < position + size)
+        {
+            *entry = -std::numeric_limits<float>::infinity();
+            *exit = std::numeric_limits<float>::infinity();
+            return true;
+        }
+        return false;
+    }
+
+    int entry_gap;
+    int exit_gap;
+    if(delta > 0)
+    {
+        entry_gap = target_position - (position + size);
+        exit_gap = target_position + target_size - position;
+    }
+    else
+    {
+        entry_gap = position - (target_position + target_size);
+        exit_gap = position + size - target_position;
+    }
+
+    *entry = static_cast<float>(entry_gap) / abs(delta);
+    *exit = static_cast<float>(exit_gap) / abs(delta);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool sweepAABB(const SDL_Rect &moving, int dx, int dy,
+               const SDL_Rect &target, SweepHit *hit)
+{
+    float entry_x, exit_x;
+    float entry_y, exit_y;
+    if(sweepAxis(moving.x, moving.w, dx, target.x, target.w, &entry_x, &exit_x) == false ||
+       sweepAxis(moving.y, moving.h, dy, target.y, target.h, &entry_y, &exit_y) == false)
+    {
+        return false;
+    }
+
+    float entry = entry_x > entry_y ? entry_x : entry_y;
+    float exit = exit_x < exit_y ? exit_x : exit_y;
+
+    //already overlapping (entry < 0), passing by or out of reach
+    if(entry < 0.0f || entry >= exit || entry >= 1.0f)
+    {
+        return false;
+    }
+
+    hit->time = entry;
+    if(entry_x > entry_y)
+    {
+        hit->normal_x = dx > 0 ? -1 : 1;
+        hit->normal_y = 0;
+    }
+    else
+    {
+        hit->normal_x = 0;
+        hit->normal_y = dy > 0 ? -1 : 1;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+SDL_Rect getSweptBounds(const SDL_Rect &moving, int dx, int dy)
+{
+    SDL_Rect bounds;
+    bounds.x = dx < 0 ? moving.x + dx : moving.x;
+    bounds.y = dy < 0 ? moving.y + dy : moving.y;
+    bounds.w = moving.w + abs(dx);
+    bounds.h = moving.h + abs(dy);
+    return bounds;
+}
+
+///////////////////////////////////////////////////////////////////////////
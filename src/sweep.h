@@ -0,0 +1,74 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <SDL2/SDL.h>
+
+#include "common.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//! first contact of a box moved along a displacement
+struct SweepHit
+{
+    SweepHit() :
+        time(1.0f),
+        normal_x(0),
+        normal_y(0)
+    {
+    }
+
+    //! fraction of the displacement done before the contact, 1.0 if
+    //! nothing was hit
+    float time;
+
+    //! points away from the surface that was hit, 0/0 if nothing was hit
+    int normal_x;
+    int normal_y;
+
+    inline bool hasHit() const
+    {
+        return normal_x != 0 || normal_y != 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Sweeps moving by dx/dy against target and returns true if it hits
+//! target before the full displacement is done. Boxes that already
+//! overlap are not reported, objects stuck inside something can leave it.
+//! Boxes that only touch (like SDL_Rect, max is exclusive) do not overlap.
+bool sweepAABB(const SDL_Rect &moving, int dx, int dy,
+               const SDL_Rect &target, SweepHit *hit);
+
+//! Bounding box of moving at its start and end position
+SDL_Rect getSweptBounds(const SDL_Rect &moving, int dx, int dy);
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
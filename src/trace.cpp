@@ -0,0 +1,281 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <time.h>
+
+#include "trace.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+//buffer of the calling thread, owned by the tracer
+static thread_local TraceBuffer *t_trace_buffer = NULL;
+
+///////////////////////////////////////////////////////////////////////////
+
+TraceBuffer::TraceBuffer(uint thread_id) :
+    thread_id(thread_id), first(NULL), last(NULL), chunk_count(0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+TraceBuffer::~TraceBuffer()
+{
+    Chunk *chunk = first;
+    while(chunk != NULL)
+    {
+        Chunk *next = chunk->next.load();
+        delete chunk;
+        chunk = next;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+Tracer::Tracer() :
+    m_enabled(false), m_dropped_events(0), m_max_chunks(0),
+    m_start_time(getTime())
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+Tracer::~Tracer()
+{
+    for(uint i = 0; i < m_buffers.size(); i++)
+    {
+        delete m_buffers[i];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint64_t Tracer::getTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::start(size_t max_events)
+{
+    m_max_chunks.store((max_events + TraceBuffer::CHUNK_EVENTS - 1) / TraceBuffer::CHUNK_EVENTS);
+    m_enabled.store(true);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::stop()
+{
+    m_enabled.store(false);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+TraceBuffer* Tracer::getThreadBuffer()
+{
+    if(t_trace_buffer == NULL)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        t_trace_buffer = new TraceBuffer(m_buffers.size() + 1);
+        m_buffers.push_back(t_trace_buffer);
+    }
+
+    return t_trace_buffer;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::append(const TraceEvent &event)
+{
+    TraceBuffer *buffer = getThreadBuffer();
+    TraceBuffer::Chunk *chunk = buffer->last;
+
+    uint count = (chunk != NULL) ? chunk->count.load(std::memory_order_relaxed) :
+                                   TraceBuffer::CHUNK_EVENTS;
+    if(count == TraceBuffer::CHUNK_EVENTS)
+    {
+        if(buffer->chunk_count >= m_max_chunks.load(std::memory_order_relaxed))
+        {
+            m_dropped_events.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceBuffer::Chunk *next = new TraceBuffer::Chunk();
+        if(chunk != NULL)
+        {
+            chunk->next.store(next, std::memory_order_release);
+        }
+        else
+        {
+            buffer->first.store(next, std::memory_order_release);
+        }
+        buffer->last = next;
+        buffer->chunk_count++;
+
+        chunk = next;
+        count = 0;
+    }
+
+    //the event is complete before readers can see it counted
+    chunk->events[count] = event;
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::recordZone(const char *name, uint64_t start, uint64_t end)
+{
+    TraceEvent event;
+    event.name = name;
+    event.type = TraceEvent::ZONE;
+    event.start = start;
+    event.duration = end - start;
+    event.value = 0.0;
+
+    append(event);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::recordCounter(const char *name, double value)
+{
+    if(isEnabled() == false)
+    {
+        return;
+    }
+
+    TraceEvent event;
+    event.name = name;
+    event.type = TraceEvent::COUNTER;
+    event.start = getTime();
+    event.duration = 0;
+    event.value = value;
+
+    append(event);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void Tracer::setThreadName(const char *name)
+{
+    TraceBuffer *buffer = getThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer->thread_name = name;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+//names are literals from our own code, quotes and backslashes are all
+//that needs escaping
+static void writeJsonString(FILE *file, const char *text)
+{
+    fputc('"', file);
+    for(; *text != '\0'; text++)
+    {
+        if(*text == '"' || *text == '\\')
+        {
+            fputc('\\', file);
+        }
+        fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode Tracer::writeChromeTrace(const string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "wt");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+                  "\"args\":{\"name\":\"storyofanerd\"}}");
+
+    for(uint i = 0; i < m_buffers.size(); i++)
+    {
+        TraceBuffer *buffer = m_buffers[i];
+
+        if(buffer->thread_name.empty() == false)
+        {
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                          "\"args\":{\"name\":", buffer->thread_id);
+            writeJsonString(file, buffer->thread_name.c_str());
+            fprintf(file, "}}");
+        }
+
+        //chunks and counts are published last, everything below them is
+        //safe to read while the owner goes on appending
+        TraceBuffer::Chunk *chunk = buffer->first.load(std::memory_order_acquire);
+        while(chunk != NULL)
+        {
+            uint count = chunk->count.load(std::memory_order_acquire);
+            for(uint j = 0; j < count; j++)
+            {
+                const TraceEvent &event = chunk->events[j];
+
+                //timestamps in microseconds since the tracer came up
+                double timestamp = (event.start - m_start_time) / 1000.0;
+
+                fprintf(file, ",\n{\"name\":");
+                writeJsonString(file, event.name);
+
+                if(event.type == TraceEvent::ZONE)
+                {
+                    fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                            buffer->thread_id, timestamp, event.duration / 1000.0);
+                }
+                else
+                {
+                    fprintf(file, ",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                                  "\"args\":{\"value\":%.17g}}",
+                            buffer->thread_id, timestamp, event.value);
+                }
+            }
+
+            chunk = chunk->next.load(std::memory_order_acquire);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    bool failed = ferror(file) != 0;
+    if(fclose(file) != 0 || failed == true)
+    {
+        return ERROR_OPENING_FILE;
+    }
+    return OK;
+}
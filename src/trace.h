@@ -0,0 +1,208 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "errorcodes.h"
+
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Instrumentation, free apart from one flag check while not started:
+//!     TRACE_ZONE("name");              time spent until the end of scope
+//!     TRACE_COUNTER("name", value);    value over time
+//!     TRACE_THREAD_NAME("name");       label of the calling thread
+//! Names have to be string literals, only the pointers are kept.
+#ifndef DISABLE_TRACING
+#define TRACE_CONCAT_NAME(name, line) name##line
+#define TRACE_ZONE_NAME(line) TRACE_CONCAT_NAME(trace_zone_, line)
+#define TRACE_ZONE(name) TraceZone TRACE_ZONE_NAME(__LINE__)(name)
+#define TRACE_COUNTER(name, value) Tracer::instance().recordCounter(name, value)
+#define TRACE_THREAD_NAME(name) Tracer::instance().setThreadName(name)
+#else
+#define TRACE_ZONE(name) do {} while(0)
+#define TRACE_COUNTER(name, value) do {} while(0)
+#define TRACE_THREAD_NAME(name) do {} while(0)
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+
+struct TraceEvent
+{
+    enum Type
+    {
+        ZONE,
+        COUNTER
+    };
+
+    const char  *name;
+    Type        type;
+    uint64_t    start;
+    uint64_t    duration;
+    double      value;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Events of one thread in a list of chunks, only the owning thread
+//! appends, exporting reads committed events from any thread
+struct TraceBuffer
+{
+    static const uint CHUNK_EVENTS = 4096;
+
+    struct Chunk
+    {
+        Chunk() :
+            count(0), next(NULL)
+        {
+        }
+
+        TraceEvent  events[CHUNK_EVENTS];
+        std::atomic<uint>   count;
+        std::atomic<Chunk*> next;
+    };
+
+    explicit TraceBuffer(uint thread_id);
+    ~TraceBuffer();
+
+    uint        thread_id;
+    //guarded by the tracer mutex
+    string      thread_name;
+
+    //allocated with the first event, threads only named cost nothing
+    std::atomic<Chunk*> first;
+    //owning thread only
+    Chunk       *last;
+    uint        chunk_count;
+
+    DISABLECOPY(TraceBuffer);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+class Tracer
+{
+    public:
+        static Tracer& instance()
+        {
+            static Tracer instance;
+            return instance;
+        }
+
+        //! events past max_events per thread are dropped
+        void start(size_t max_events = DEFAULT_MAX_EVENTS);
+        void stop();
+
+        inline bool isEnabled() const
+        {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+
+        void recordZone(const char *name, uint64_t start, uint64_t end);
+        void recordCounter(const char *name, double value);
+        void setThreadName(const char *name);
+
+        //! Chrome trace event JSON, opens in chrome://tracing and Perfetto;
+        //! may be called any time, tracing goes on while it writes
+        ErrorCode writeChromeTrace(const string &filename);
+
+        inline uint64_t getDroppedEvents() const
+        {
+            return m_dropped_events.load(std::memory_order_relaxed);
+        }
+
+        //! nanoseconds, CLOCK_MONOTONIC
+        static uint64_t getTime();
+
+    private:
+        Tracer();
+        ~Tracer();
+
+        static const size_t DEFAULT_MAX_EVENTS = 1 << 20;
+
+        TraceBuffer* getThreadBuffer();
+        void append(const TraceEvent &event);
+
+        std::atomic<bool>       m_enabled;
+        std::atomic<uint64_t>   m_dropped_events;
+        std::atomic<uint>       m_max_chunks;
+        uint64_t    m_start_time;
+
+        std::mutex  m_mutex;
+        vector<TraceBuffer*> m_buffers;
+
+        DISABLECOPY(Tracer);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! see TRACE_ZONE
+class TraceZone
+{
+    public:
+        explicit TraceZone(const char *name)
+        {
+            Tracer &tracer = Tracer::instance();
+            if(tracer.isEnabled() == true)
+            {
+                m_name = name;
+                m_start = Tracer::getTime();
+            }
+            else
+            {
+                m_name = NULL;
+                m_start = 0;
+            }
+        }
+
+        ~TraceZone()
+        {
+            if(m_name != NULL)
+            {
+                Tracer::instance().recordZone(m_name, m_start, Tracer::getTime());
+            }
+        }
+
+    private:
+        const char  *m_name;
+        uint64_t    m_start;
+
+        DISABLECOPY(TraceZone);
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -25,74 +25,79 @@
  *-----------------------------------------------------------------------*/
 
 #include <SDL2/SDL.h>
-#include <sstream>
 #include <cassert>
+#include <string.h>
 
 #include "xmlloader.h"
+#include "binarymap.h"
 #include "logging.h"
+#include "trace.h"
 
 //monkey monkey
-const string LoadedMap::XML_MAP             = "map";
-const string LoadedMap::XML_MAP_WIDTH       = "width";
-const string LoadedMap::XML_MAP_HEIGHT      = "height";
-const string LoadedMap::XML_MAP_TILEWIDTH   = "tilewidth";
-const string LoadedMap::XML_MAP_TILEHEIGHT  = "tileheight";
-
-const string LoadedMap::XML_TILESET         = "tileset";
-const string LoadedMap::XML_TILESET_NAME    = "name";
-const string LoadedMap::XML_TILESET_WIDTH   = "tilewidth";
-const string LoadedMap::XML_TILESET_HEIGHT  = "tileheight";
-const string LoadedMap::XML_TILESET_SPACING = "spacing";
-const string LoadedMap::XML_TILESET_MARGIN  = "margin";
-
-const string LoadedMap::XML_IMAGE           = "image";
-const string LoadedMap::XML_IMAGE_SOURCE    = "source";
-const string LoadedMap::XML_IMAGE_WIDTH     = "width";
-const string LoadedMap::XML_IMAGE_HEIGHT    = "height";
-
-const string LoadedMap::XML_TERRAINTYPE     = "terraintypes";
-const string LoadedMap::XML_TERRAIN         = "terrain";
-const string LoadedMap::XML_TERRAIN_NAME    = "name";
-const string LoadedMap::XML_TERRAIN_TILE    = "tile";
-const string LoadedMap::XML_TERRAIN_PROPS   = "properties";
-const string LoadedMap::XML_TERRAIN_PROP    = "property";
-const string LoadedMap::XML_TERRAIN_PROP_NAME   = "name";
-const string LoadedMap::XML_TERRAIN_PROP_VALUE  = "value";
-
-const string LoadedMap::XML_TILE            = "tile";
-const string LoadedMap::XML_TILE_ID         = "id";
-const string LoadedMap::XML_TILE_TERRAIN    = "terrain";
-
-const string LoadedMap::XML_LAYER           = "layer";
-const string LoadedMap::XML_LAYER_NAME      = "name";
-const string LoadedMap::XML_LAYER_WIDTH     = "width";
-const string LoadedMap::XML_LAYER_HEIGHT    = "height";
-const string LoadedMap::XML_LAYER_DATA      = "data";
-const string LoadedMap::XML_LAYER_DATA_ENCODING     = "encoding";
-const string LoadedMap::XML_LAYER_DATA_COMPRESSION  = "compression";
-
-const string LoadedMap::XML_OBJECTGROUP             = "objectgroup";
-const string LoadedMap::XML_OBJECTGROUP_DRAWORDER   = "draworder";
-const string LoadedMap::XML_OBJECTGROUP_NAME        = "name";
-const string LoadedMap::XML_OBJECTGROUP_WIDTH       = "width";
-const string LoadedMap::XML_OBJECTGROUP_HEIGHT      = "height";
-
-const string LoadedMap::XML_OBJECTGROUP_PROPS       = "properties";
-const string LoadedMap::XML_OBJECTGROUP_PROP        = "property";
-const string LoadedMap::XML_OBJECTGROUP_PROP_NAME   = "name";
-const string LoadedMap::XML_OBJECTGROUP_PROP_VALUE  = "value";
-
-const string LoadedMap::XML_OBJECT                  = "object";
-const string LoadedMap::XML_OBJECT_NAME             = "name";
-const string LoadedMap::XML_OBJECT_X                = "x";
-const string LoadedMap::XML_OBJECT_Y                = "y";
-const string LoadedMap::XML_OBJECT_WIDTH            = "width";
-const string LoadedMap::XML_OBJECT_HEIGHT           = "height";
+const char* const LoadedMap::XML_MAP             = "map";
+const char* const LoadedMap::XML_MAP_WIDTH       = "width";
+const char* const LoadedMap::XML_MAP_HEIGHT      = "height";
+const char* const LoadedMap::XML_MAP_TILEWIDTH   = "tilewidth";
+const char* const LoadedMap::XML_MAP_TILEHEIGHT  = "tileheight";
+
+const char* const LoadedMap::XML_TILESET         = "tileset";
+const char* const LoadedMap::XML_TILESET_NAME    = "name";
+const char* const LoadedMap::XML_TILESET_FIRSTGID = "firstgid";
+const char* const LoadedMap::XML_TILESET_WIDTH   = "tilewidth";
+const char* const LoadedMap::XML_TILESET_HEIGHT  = "tileheight";
+const char* const LoadedMap::XML_TILESET_SPACING = "spacing";
+const char* const LoadedMap::XML_TILESET_MARGIN  = "margin";
+
+const char* const LoadedMap::XML_IMAGE           = "image";
+const char* const LoadedMap::XML_IMAGE_SOURCE    = "source";
+const char* const LoadedMap::XML_IMAGE_WIDTH     = "width";
+const char* const LoadedMap::XML_IMAGE_HEIGHT    = "height";
+
+const char* const LoadedMap::XML_TERRAINTYPE     = "terraintypes";
+const char* const LoadedMap::XML_TERRAIN         = "terrain";
+const char* const LoadedMap::XML_TERRAIN_NAME    = "name";
+const char* const LoadedMap::XML_TERRAIN_TILE    = "tile";
+const char* const LoadedMap::XML_TERRAIN_PROPS   = "properties";
+
+const char* const LoadedMap::XML_TILE            = "tile";
+const char* const LoadedMap::XML_TILE_ID         = "id";
+const char* const LoadedMap::XML_TILE_TERRAIN    = "terrain";
+
+const char* const LoadedMap::XML_LAYER           = "layer";
+const char* const LoadedMap::XML_LAYER_NAME      = "name";
+const char* const LoadedMap::XML_LAYER_WIDTH     = "width";
+const char* const LoadedMap::XML_LAYER_HEIGHT    = "height";
+const char* const LoadedMap::XML_LAYER_DATA      = "data";
+const char* const LoadedMap::XML_LAYER_DATA_ENCODING     = "encoding";
+const char* const LoadedMap::XML_LAYER_DATA_COMPRESSION  = "compression";
+
+const char* const LoadedMap::XML_OBJECTGROUP             = "objectgroup";
+const char* const LoadedMap::XML_OBJECTGROUP_DRAWORDER   = "draworder";
+const char* const LoadedMap::XML_OBJECTGROUP_NAME        = "name";
+const char* const LoadedMap::XML_OBJECTGROUP_WIDTH       = "width";
+const char* const LoadedMap::XML_OBJECTGROUP_HEIGHT      = "height";
+
+const char* const LoadedMap::XML_OBJECTGROUP_PROPS       = "properties";
+
+const char* const LoadedMap::XML_PROPERTY                = "property";
+const char* const LoadedMap::XML_PROPERTY_NAME           = "name";
+const char* const LoadedMap::XML_PROPERTY_VALUE          = "value";
+
+const char* const LoadedMap::XML_OBJECT                  = "object";
+const char* const LoadedMap::XML_OBJECT_NAME             = "name";
+const char* const LoadedMap::XML_OBJECT_X                = "x";
+const char* const LoadedMap::XML_OBJECT_Y                = "y";
+const char* const LoadedMap::XML_OBJECT_WIDTH            = "width";
+const char* const LoadedMap::XML_OBJECT_HEIGHT           = "height";
+
+const char* const LoadedMap::PROPERTY_COLLISION          = "collision";
 
 ///////////////////////////////////////////////////////////////////////////
 
 LoadedMap::LoadedMap(const string &filename) :
-    m_filename(filename)
+    m_filename(filename),
+    m_load_progress(0.0f),
+    m_default_collision_mask(0)
 {
 }
 
@@ -106,39 +111,37 @@ LoadedMap::~LoadedMap()
 
 ErrorCode LoadedMap::loadFile()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadFile start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadFile start\n");
+    TRACE_ZONE("LoadedMap::loadFile");
 
-    int ret = m_doc.LoadFile(m_filename.c_str());
+    ErrorCode ret = m_mapped_file.open(m_filename);
+    if(ret != OK)
+    {
+        return ret;
+    }
 
-    if(ret != 0)
+    if(m_mapped_file.getSize() >= sizeof(BINARYMAP_MAGIC) &&
+       memcmp(m_mapped_file.getData(), BINARYMAP_MAGIC, sizeof(BINARYMAP_MAGIC)) == 0)
     {
-        return ERROR_OPENING_FILE;
+        ret = loadBinaryFile();
     }
+    else
+    {
+        ret = loadXMLFile();
 
-    XMLElement *root_map = m_doc.FirstChildElement(XML_MAP.c_str());
-    assert(root_map);
-    loadMap(root_map);
+        //everything is copied out, no need to keep the text around
+        m_mapped_file.close();
+    }
 
-    XMLElement *child = root_map->FirstChildElement();
-    assert(child);
-    while(child != NULL)
+    if(ret != OK)
     {
-        if(child->Name() == XML_TILESET)
-        {
-            loadTileset(child);
-        }
-        else if(child->Name() == XML_LAYER)
-        {
-            loadLayer(child);
-        }
-        else if(child->Name() == XML_OBJECTGROUP)
-        {
-            loadObjectGroup(child);
-        }
-        child = child->NextSiblingElement();
+        return ret;
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadFile end\n");
+    buildCollisionMaps();
+
+    m_load_progress = 1.0f;
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadFile end\n");
 
     printMapInformation();
     return OK;
@@ -146,368 +149,688 @@ ErrorCode LoadedMap::loadFile()
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadMap(XMLElement *element)
+string LoadedMap::getDirectory() const
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadMap start\n");
-    stringstream width (element->Attribute(XML_MAP_WIDTH.c_str()));
-    stringstream height (element->Attribute(XML_MAP_HEIGHT.c_str()));
-    stringstream tilewidth (element->Attribute(XML_MAP_TILEWIDTH.c_str()));
-    stringstream tileheight (element->Attribute(XML_MAP_TILEHEIGHT.c_str()));
-    width >> m_map.width;
-    height >> m_map.height;
-    tilewidth >> m_map.tilewidth;
-    tileheight >> m_map.tileheight;
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadMap end\n");
+    size_t separator = m_filename.find_last_of('/');
+    if(separator == string::npos)
+    {
+        return "";
+    }
+    return m_filename.substr(0, separator + 1);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadTileset(XMLElement *element)
+bool LoadedMap::setLayerGid(uint layer, uint index, uint32_t gid)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTileset\n");
+    if(layer >= m_layers.size())
+    {
+        return false;
+    }
+
+    Layer &target = m_layers.at(layer);
+    if(index >= target.width * target.height)
+    {
+        return false;
+    }
+
+    //compiled maps are mapped read only, copy the layer on first write
+    if(target.mapped_gids != NULL)
+    {
+        target.gids.assign(target.mapped_gids, target.mapped_gids + target.width * target.height);
+        target.mapped_gids = NULL;
+    }
 
-    assert(element);
+    target.gids[index] = gid;
 
-    TileSet tileset;
-    tileset.name = element->Attribute(XML_TILESET_NAME.c_str());
+    if(layer < m_collision_maps.size() && target.width > 0)
+    {
+        m_collision_maps.at(layer).setTile(index % target.width, index / target.width,
+                                           getCollisionMask(gid));
+    }
+    return true;
+}
 
-    stringstream tilewidth (element->Attribute(XML_TILESET_WIDTH.c_str()));
-    stringstream tileheight (element->Attribute(XML_TILESET_HEIGHT.c_str()));
-    stringstream spacing (element->Attribute(XML_TILESET_SPACING.c_str()));
-    stringstream margin (element->Attribute(XML_TILESET_MARGIN.c_str()));
+///////////////////////////////////////////////////////////////////////////
 
-    tilewidth >> tileset.tilewidth;
-    tileheight >> tileset.tileheight;
-    spacing >> tileset.spacing;
-    margin >> tileset.margin;
+ErrorCode LoadedMap::loadXMLFile()
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadXMLFile start\n");
 
-    XMLElement *image = element->FirstChildElement(XML_IMAGE.c_str());
-    assert(image);
-    loadImageSource(image, &tileset);
+    XmlReader reader(m_mapped_file.getData(), m_mapped_file.getSize());
 
-    XMLElement *terrains = element->FirstChildElement(XML_TERRAINTYPE.c_str());
-    assert(terrains);
-    loadTerrains(terrains, &tileset);
+    //everything in front of <map> (declaration, comments) is skipped
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_START_ELEMENT || reader.getName().equals(XML_MAP) == false)
+    {
+        if(token == XmlReader::TOKEN_END_OF_DOCUMENT || token == XmlReader::TOKEN_ERROR)
+        {
+            return ERROR_INVALID_DATA;
+        }
+        token = reader.next();
+    }
+
+    loadMap(reader);
 
-    XMLElement *first_tile = element->FirstChildElement(XML_TILE.c_str());
-    assert(first_tile);
+    token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
+    {
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_TILESET))
+            {
+                ret = loadTileset(reader);
+            }
+            else if(reader.getName().equals(XML_LAYER))
+            {
+                ret = loadLayer(reader);
+            }
+            else if(reader.getName().equals(XML_OBJECTGROUP))
+            {
+                ret = loadObjectGroup(reader);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            ret = ERROR_INVALID_DATA;
+        }
 
-    //NOTE: MUST push first because we reference afterwards (terrain
-    //pointers)
-    m_tilesets.push_back(tileset);
-    loadTiles(first_tile, &m_tilesets.back());
+        if(ret != OK)
+        {
+            return ret;
+        }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTileset end\n");
+        m_load_progress = static_cast<float>(reader.getOffset()) / reader.getSize();
+        token = reader.next();
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadXMLFile end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadImageSource(XMLElement *element, TileSet *target)
+void LoadedMap::loadMap(XmlReader &reader)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadImageSource start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadMap start\n");
+    m_map.width         = reader.getAttributeUInt(XML_MAP_WIDTH);
+    m_map.height        = reader.getAttributeUInt(XML_MAP_HEIGHT);
+    m_map.tilewidth     = reader.getAttributeUInt(XML_MAP_TILEWIDTH);
+    m_map.tileheight    = reader.getAttributeUInt(XML_MAP_TILEHEIGHT);
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadMap end\n");
+}
 
-    assert(element);
-    assert(target);
+///////////////////////////////////////////////////////////////////////////
 
-    target->image.source_image = getAttributeString(element, XML_IMAGE_SOURCE);
+ErrorCode LoadedMap::loadTileset(XmlReader &reader)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTileset\n");
 
-    stringstream width (element->Attribute(XML_IMAGE_WIDTH.c_str()));
-    stringstream height (element->Attribute(XML_IMAGE_HEIGHT.c_str()));
+    //NOTE: filled in place, the terrain pointers reference into it
+    m_tilesets.push_back(TileSet());
+    TileSet &tileset = m_tilesets.back();
 
-    width >> target->image.width;
-    height >> target->image.height;
+    tileset.name        = getAttributeString(reader, XML_TILESET_NAME);
+    tileset.firstgid    = reader.getAttributeUInt(XML_TILESET_FIRSTGID, 1);
+    tileset.tilewidth   = reader.getAttributeUInt(XML_TILESET_WIDTH);
+    tileset.tileheight  = reader.getAttributeUInt(XML_TILESET_HEIGHT);
+    tileset.spacing     = reader.getAttributeUInt(XML_TILESET_SPACING);
+    tileset.margin      = reader.getAttributeUInt(XML_TILESET_MARGIN);
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadImageSource end\n");
+    //terrain indices of the tiles (4 per tile), mapped once all
+    //terrains are known
+    vector<int> tile_terrains;
+
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
+    {
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_IMAGE))
+            {
+                ret = loadImageSource(reader, &tileset);
+            }
+            else if(reader.getName().equals(XML_TERRAINTYPE))
+            {
+                ret = loadTerrains(reader, &tileset);
+            }
+            else if(reader.getName().equals(XML_TILE))
+            {
+                ret = loadTile(reader, &tileset, &tile_terrains);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            ret = ERROR_INVALID_DATA;
+        }
+
+        if(ret != OK)
+        {
+            return ret;
+        }
+        token = reader.next();
+    }
+
+    mapTilesToTerrainPointers(tile_terrains, &tileset);
+
+    LOGMESSAGE(LOG_DEBUG, LOG_MAP, "LoadedMap::loadTileset: Loaded %d tiles for %s\n",
+                      tileset.tiles.size(), tileset.name.c_str());
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTileset end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadTerrains(XMLElement *element, TileSet *target)
+ErrorCode LoadedMap::loadImageSource(XmlReader &reader, TileSet *target)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrains start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadImageSource start\n");
 
-    assert(element);
     assert(target);
 
-    XMLElement *terrain = element->FirstChildElement(XML_TERRAIN.c_str());
+    target->image.source_image  = getAttributeString(reader, XML_IMAGE_SOURCE);
+    target->image.width         = reader.getAttributeUInt(XML_IMAGE_WIDTH);
+    target->image.height        = reader.getAttributeUInt(XML_IMAGE_HEIGHT);
 
-    Logger.logMessage(LOG_DEBUG, LOG_MAP, "LoadedMap::loadTerrains: Found first terrain\n");
-    while(terrain)
-    {
-        TerrainType parsed_terrain;
-        parsed_terrain.name = getAttributeString(terrain, XML_TERRAIN_NAME);
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadImageSource end\n");
+    return reader.skipElement() ? OK : ERROR_INVALID_DATA;
+}
 
-        stringstream tile (terrain->Attribute(XML_TERRAIN_TILE.c_str()));
-        tile >> parsed_terrain.tile;
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode LoadedMap::loadTerrains(XmlReader &reader, TileSet *target)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrains start\n");
+
+    assert(target);
 
-        XMLElement *properties = terrain->FirstChildElement(XML_TERRAIN_PROPS.c_str());
-        if(properties)
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
+    {
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_TERRAIN))
+            {
+                ret = loadTerrain(reader, target);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
         {
-            loadTerrainProperties(properties, &parsed_terrain);
+            ret = ERROR_INVALID_DATA;
         }
 
-        target->terraintypes.push_back(parsed_terrain);
-        terrain = terrain->NextSiblingElement();
+        if(ret != OK)
+        {
+            return ret;
+        }
+        token = reader.next();
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrains end\n");
+    LOGMESSAGE(LOG_DEBUG, LOG_MAP, "LoadedMap::loadTerrains: Loaded %d terrains\n",
+                      target->terraintypes.size());
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrains end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadTerrainProperties(XMLElement *element, TerrainType *target)
+ErrorCode LoadedMap::loadTerrain(XmlReader &reader, TileSet *target)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrainProperties start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrain start\n");
 
-    assert(element);
     assert(target);
 
-    XMLElement *property = element->FirstChildElement(XML_TERRAIN_PROP.c_str());
-    while(property != NULL)
+    TerrainType parsed_terrain;
+    parsed_terrain.name = getAttributeString(reader, XML_TERRAIN_NAME);
+    parsed_terrain.tile = reader.getAttributeUInt(XML_TERRAIN_TILE);
+
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
     {
-        std::pair<string, string> parsed_property;
-        parsed_property.first = getAttributeString(property, XML_TERRAIN_PROP_NAME);
-        parsed_property.second= getAttributeString(property, XML_TERRAIN_PROP_VALUE);
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_TERRAIN_PROPS))
+            {
+                ret = loadProperties(reader, &parsed_terrain.properties);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            ret = ERROR_INVALID_DATA;
+        }
 
-        target->properties.insert(parsed_property);
-        property = property->NextSiblingElement();
+        if(ret != OK)
+        {
+            return ret;
+        }
+        token = reader.next();
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrainProperties end\n");
+    target->terraintypes.push_back(parsed_terrain);
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTerrain end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadTiles(XMLElement *element, TileSet *target)
+ErrorCode LoadedMap::loadProperties(XmlReader &reader, map<string, string> *target)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTiles start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadProperties start\n");
 
     assert(target);
 
-    while(element != NULL)
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
     {
-        Tile parsed_tile;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_PROPERTY))
+            {
+                std::pair<string, string> parsed_property;
+                parsed_property.first = getAttributeString(reader, XML_PROPERTY_NAME);
+                parsed_property.second= getAttributeString(reader, XML_PROPERTY_VALUE);
+
+                target->insert(parsed_property);
+            }
+
+            if(reader.skipElement() == false)
+            {
+                return ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            return ERROR_INVALID_DATA;
+        }
+        token = reader.next();
+    }
 
-        stringstream tile_id (element->Attribute(XML_TILE_ID.c_str()));
-        tile_id >> parsed_tile.id; 
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadProperties end\n");
+    return OK;
+}
 
-        string tile_terrains = element->Attribute(XML_TILE_TERRAIN.c_str());
-        mapTilesToTerrainPointers(tile_terrains, target, &parsed_tile);
+///////////////////////////////////////////////////////////////////////////
 
-        target->tiles.push_back(parsed_tile);
+ErrorCode LoadedMap::loadTile(XmlReader &reader, TileSet *target, vector<int> *terrains)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTile start\n");
 
-        element = element->NextSiblingElement();
+    assert(target);
+    assert(terrains);
+
+    Tile parsed_tile;
+    parsed_tile.id = reader.getAttributeUInt(XML_TILE_ID);
+    parsed_tile.terrain_1 = NULL;
+    parsed_tile.terrain_2 = NULL;
+    parsed_tile.terrain_3 = NULL;
+    parsed_tile.terrain_4 = NULL;
+    target->tiles.push_back(parsed_tile);
+
+    //"a,b,c,d" with empty entries for corners without terrain
+    int corners[4] = { -1, -1, -1, -1 };
+    XmlSpan parsed;
+    if(reader.getAttribute(XML_TILE_TERRAIN, &parsed) == true)
+    {
+        uint corner = 0;
+        for(size_t i = 0; i < parsed.length && corner < 4; i++)
+        {
+            char c = parsed.data[i];
+            if(c == ',')
+            {
+                corner++;
+            }
+            else if(c >= '0' && c <= '9')
+            {
+                corners[corner] = (corners[corner] < 0 ? 0 : corners[corner] * 10) + (c - '0');
+            }
+        }
     }
+    terrains->insert(terrains->end(), corners, corners + 4);
 
-    Logger.logMessage(LOG_DEBUG, LOG_MAP, "LoadedMap::loadTiles: Loaded %d tiles for %s\n",
-                      target->tiles.size(), target->name.c_str());
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadTiles start end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadTile end\n");
+    return reader.skipElement() ? OK : ERROR_INVALID_DATA;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::mapTilesToTerrainPointers(string parsed, TileSet *tset, Tile *target)
+void LoadedMap::mapTilesToTerrainPointers(const vector<int> &terrains, TileSet *tset)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::mapTilesToTerrainPointers start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::mapTilesToTerrainPointers start\n");
 
     assert(tset);
-    assert(target);
+    assert(terrains.size() == tset->tiles.size() * 4);
 
-    std::stringstream ss(parsed);
-
-    int parsed_val;
-    int cnt = 1;
-    while (ss >> parsed_val && cnt <= 4)
+    for(uint i = 0; i < tset->tiles.size(); i++)
     {
-        switch(cnt)
-        {
-            case 1:
-                target->terrain_1 = &tset->terraintypes[parsed_val];
-                Logger.logMessage(LOG_DEBUG2, LOG_MAP, "Mapping terraintype 1 to %s\n",
-                                  target->terrain_1->name.c_str());
-                break;
-            case 2:
-                target->terrain_2 = &tset->terraintypes[parsed_val];
-                Logger.logMessage(LOG_DEBUG2, LOG_MAP, "Mapping terraintype 2 to %s\n",
-                                  target->terrain_2->name.c_str());
-                break;
-            case 3:
-                target->terrain_3 = &tset->terraintypes[parsed_val];
-                Logger.logMessage(LOG_DEBUG2, LOG_MAP, "Mapping terraintype 3 to %s\n",
-                                  target->terrain_3->name.c_str());
-                break;
-            case 4:
-                target->terrain_4 = &tset->terraintypes[parsed_val];
-                Logger.logMessage(LOG_DEBUG2, LOG_MAP, "Mapping terraintype 4 to %s\n",
-                                  target->terrain_4->name.c_str());
-                break;
-        }
+        Tile &target = tset->tiles.at(i);
+        TerrainType **corners[4] = { &target.terrain_1, &target.terrain_2,
+                                     &target.terrain_3, &target.terrain_4 };
 
-        if (ss.peek() == ',')
+        for(uint corner = 0; corner < 4; corner++)
         {
-            ss.ignore();
+            int parsed_val = terrains.at(i * 4 + corner);
+            if(parsed_val < 0 || static_cast<uint>(parsed_val) >= tset->terraintypes.size())
+            {
+                continue;
+            }
+
+            *corners[corner] = &tset->terraintypes[parsed_val];
+            LOGMESSAGE(LOG_DEBUG2, LOG_MAP, "Mapping terraintype %u to %s\n",
+                              corner + 1, (*corners[corner])->name.c_str());
         }
-
-        cnt = cnt + 1;
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::mapTilesToTerrainPointers end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::mapTilesToTerrainPointers end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadLayer(XMLElement *element)
+void LoadedMap::buildCollisionMaps()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadLayer start\n");
-
-    assert(element);
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::buildCollisionMaps start\n");
+    TRACE_ZONE("LoadedMap::buildCollisionMaps");
 
-    Layer parsed_layer;
+    m_tile_collision_masks.clear();
+    bool has_collision_terrain = false;
 
-    parsed_layer.name = getAttributeString(element, XML_LAYER_NAME);
-
-    stringstream width (element->Attribute(XML_LAYER_WIDTH.c_str()));
-    stringstream height (element->Attribute(XML_LAYER_HEIGHT.c_str()));
-
-    width >> parsed_layer.width;
-    height >> parsed_layer.height;
-
-    XMLElement *data = element->FirstChildElement(XML_LAYER_DATA.c_str());
-    if(data != NULL)
+    for(uint i = 0; i < m_tilesets.size(); i++)
     {
-        parsed_layer.encoding = getAttributeString(data, XML_LAYER_DATA_ENCODING);
-        if(parsed_layer.encoding != "csv")
+        const TileSet &tileset = m_tilesets.at(i);
+        for(uint j = 0; j < tileset.tiles.size(); j++)
         {
-            parsed_layer.compression = getAttributeString(data, XML_LAYER_DATA_COMPRESSION);
+            const Tile &tile = tileset.tiles.at(j);
+            const TerrainType *corners[4] = { tile.terrain_1, tile.terrain_2,
+                                              tile.terrain_3, tile.terrain_4 };
+
+            uint8_t mask = 0;
+            for(uint corner = 0; corner < 4; corner++)
+            {
+                if(corners[corner] == NULL)
+                {
+                    continue;
+                }
+
+                map<string, string>::const_iterator it =
+                    corners[corner]->properties.find(PROPERTY_COLLISION);
+                if(it != corners[corner]->properties.end())
+                {
+                    has_collision_terrain = true;
+                    if(it->second != "" && it->second != "0" && it->second != "false")
+                    {
+                        mask |= 1 << corner;
+                    }
+                }
+            }
+
+            uint32_t gid = tileset.firstgid + tile.id;
+            if(mask != 0)
+            {
+                if(gid >= m_tile_collision_masks.size())
+                {
+                    m_tile_collision_masks.resize(gid + 1, 0);
+                }
+                m_tile_collision_masks[gid] = mask;
+            }
         }
-        parsed_layer.data = data->GetText();
     }
 
-    Logger.logMessage(LOG_DEBUG, LOG_MAP, "LoadedMap::loadLayer: Loaded layer: %s\n",
-                      parsed_layer.name.c_str());
-    m_layers.push_back(parsed_layer);
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadLayer end\n");
+    //maps without collision terrains keep the old behaviour, any tile blocks
+    m_default_collision_mask = has_collision_terrain == true ? 0 : COLLISION_FULL_TILE;
+
+    m_collision_maps.clear();
+    m_collision_maps.resize(m_layers.size());
+    for(uint i = 0; i < m_layers.size(); i++)
+    {
+        m_collision_maps.at(i).build(m_layers.at(i).width, m_layers.at(i).height,
+                                     m_map.tilewidth, m_map.tileheight,
+                                     getLayerGids(i), m_tile_collision_masks,
+                                     m_default_collision_mask);
+        LOGMESSAGE(LOG_DEBUG, LOG_MAP, "LoadedMap::buildCollisionMaps: "
+                   "Layer %u merged into %u static colliders\n",
+                   i, m_collision_maps.at(i).getColliderCount());
+    }
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::buildCollisionMaps end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadObjectGroup(XMLElement *element)
+uint8_t LoadedMap::getCollisionMask(uint32_t gid) const
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroup start\n");
-
-    assert(element);
-
-    ObjectGroup parsed_group;
+    gid = gid & GID_MASK;
+    if(gid == 0)
+    {
+        return 0;
+    }
+    if(gid < m_tile_collision_masks.size())
+    {
+        return m_tile_collision_masks[gid];
+    }
+    return m_default_collision_mask;
+}
 
-    parsed_group.draworder = getAttributeString(element, XML_OBJECTGROUP_DRAWORDER);
-    parsed_group.name = getAttributeString(element, XML_OBJECTGROUP_NAME);
+///////////////////////////////////////////////////////////////////////////
 
-    stringstream width (element->Attribute(XML_OBJECTGROUP_WIDTH.c_str()));
-    stringstream height (element->Attribute(XML_OBJECTGROUP_HEIGHT.c_str()));
+ErrorCode LoadedMap::loadLayer(XmlReader &reader)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadLayer start\n");
 
-    width >> parsed_group.width;
-    height >> parsed_group.height;
+    //push first, the gids are decoded straight into the stored layer
+    m_layers.push_back(Layer());
+    Layer &layer = m_layers.back();
 
-    XMLElement *first_object = element->FirstChildElement(XML_OBJECT.c_str());
-    loadObjects(first_object, &parsed_group);
+    layer.name          = getAttributeString(reader, XML_LAYER_NAME);
+    layer.width         = reader.getAttributeUInt(XML_LAYER_WIDTH);
+    layer.height        = reader.getAttributeUInt(XML_LAYER_HEIGHT);
+    layer.mapped_gids   = NULL;
 
-    XMLElement *properties = element->FirstChildElement(XML_OBJECTGROUP_PROPS.c_str());
-    if(properties != NULL)
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
     {
-        loadObjectGroupProperties(properties, &parsed_group);
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_LAYER_DATA))
+            {
+                ret = loadLayerData(reader, &layer);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            ret = ERROR_INVALID_DATA;
+        }
+
+        if(ret != OK)
+        {
+            return ret;
+        }
+        token = reader.next();
     }
-    m_objectgroups.push_back(parsed_group);
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroup end\n");
+    LOGMESSAGE(LOG_DEBUG, LOG_MAP, "LoadedMap::loadLayer: Loaded layer: %s\n",
+                      layer.name.c_str());
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadLayer end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadObjects(XMLElement *element, ObjectGroup *target)
+ErrorCode LoadedMap::loadLayerData(XmlReader &reader, Layer *target)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjects start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadLayerData start\n");
 
     assert(target);
 
-    while(element != NULL)
+    target->encoding = getAttributeString(reader, XML_LAYER_DATA_ENCODING);
+    if(target->encoding != "csv" && reader.hasAttribute(XML_LAYER_DATA_COMPRESSION))
     {
-        Object parsed_object;
+        target->compression = getAttributeString(reader, XML_LAYER_DATA_COMPRESSION);
+    }
 
-        parsed_object.name = getAttributeString(element, XML_OBJECT_NAME);
+    //the text is decoded in place, straight out of the mapped file
+    XmlSpan text;
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
+    {
+        if(token == XmlReader::TOKEN_TEXT && text.data == NULL)
+        {
+            text = reader.getText();
+        }
+        else if(token != XmlReader::TOKEN_START_ELEMENT || reader.skipElement() == false)
+        {
+            return ERROR_INVALID_DATA;
+        }
+        token = reader.next();
+    }
 
-        stringstream x (element->Attribute(XML_OBJECT_X.c_str()));
-        stringstream y (element->Attribute(XML_OBJECT_Y.c_str()));
+    //the same limit as a compiled map, whose offsets are 32 bits
+    uint64_t tile_count = static_cast<uint64_t>(target->width) * target->height;
+    if(tile_count * sizeof(uint32_t) > UINT32_MAX)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::loadLayerData: "
+                          "Layer %s is too large (%ux%u)\n",
+                          target->name.c_str(), target->width, target->height);
+        return ERROR_INVALID_DATA;
+    }
 
-        stringstream width (element->Attribute(XML_OBJECT_WIDTH.c_str()));
-        stringstream height (element->Attribute(XML_OBJECT_HEIGHT.c_str()));
+    ErrorCode ret = decodeLayerData(text.data ? text.data : "", text.length,
+                                    target->encoding, target->compression,
+                                    static_cast<size_t>(tile_count), target->gids);
+    if(ret != OK)
+    {
+        LOGMESSAGE(LOG_ERROR, LOG_MAP, "LoadedMap::loadLayerData: "
+                          "Unable to decode layer %s (%s)\n",
+                          target->name.c_str(), ERRORMSG(ret).c_str());
+        return ret;
+    }
 
-        x >> parsed_object.bbox.x;
-        y >> parsed_object.bbox.y;
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadLayerData end\n");
+    return OK;
+}
 
-        width >> parsed_object.bbox.w;
-        height >> parsed_object.bbox.h;
+///////////////////////////////////////////////////////////////////////////
 
-        target->objects.push_back(parsed_object);
-        element = element ->NextSiblingElement();
+ErrorCode LoadedMap::loadObjectGroup(XmlReader &reader)
+{
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroup start\n");
+
+    ObjectGroup parsed_group;
+
+    parsed_group.draworder  = getAttributeString(reader, XML_OBJECTGROUP_DRAWORDER);
+    parsed_group.name       = getAttributeString(reader, XML_OBJECTGROUP_NAME);
+    parsed_group.width      = reader.getAttributeUInt(XML_OBJECTGROUP_WIDTH);
+    parsed_group.height     = reader.getAttributeUInt(XML_OBJECTGROUP_HEIGHT);
+
+    XmlReader::Token token = reader.next();
+    while(token != XmlReader::TOKEN_END_ELEMENT)
+    {
+        ErrorCode ret = OK;
+        if(token == XmlReader::TOKEN_START_ELEMENT)
+        {
+            if(reader.getName().equals(XML_OBJECT))
+            {
+                ret = loadObject(reader, &parsed_group);
+            }
+            else if(reader.getName().equals(XML_OBJECTGROUP_PROPS))
+            {
+                ret = loadProperties(reader, &parsed_group.properties);
+            }
+            else if(reader.skipElement() == false)
+            {
+                ret = ERROR_INVALID_DATA;
+            }
+        }
+        else if(token != XmlReader::TOKEN_TEXT)
+        {
+            ret = ERROR_INVALID_DATA;
+        }
+
+        if(ret != OK)
+        {
+            return ret;
+        }
+        token = reader.next();
     }
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjects end\n");
+    m_objectgroups.push_back(parsed_group);
+
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroup end\n");
+    return OK;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-void LoadedMap::loadObjectGroupProperties(XMLElement *element, ObjectGroup *target)
+ErrorCode LoadedMap::loadObject(XmlReader &reader, ObjectGroup *target)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroupProperties start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadObject start\n");
 
-    assert(element);
     assert(target);
 
-    XMLElement *property = element->FirstChildElement(XML_OBJECTGROUP_PROP.c_str());
-    while(property != NULL)
-    {
-        std::pair<string, string> parsed_property;
-        parsed_property.first = getAttributeString(property, XML_OBJECTGROUP_PROP_NAME);
-        parsed_property.second= getAttributeString(property, XML_OBJECTGROUP_PROP_VALUE);
+    Object parsed_object;
 
-        target->properties.insert(parsed_property);
-        property = property->NextSiblingElement();
-    }
+    parsed_object.name      = getAttributeString(reader, XML_OBJECT_NAME);
+    parsed_object.bbox.x    = reader.getAttributeInt(XML_OBJECT_X);
+    parsed_object.bbox.y    = reader.getAttributeInt(XML_OBJECT_Y);
+    parsed_object.bbox.w    = reader.getAttributeInt(XML_OBJECT_WIDTH);
+    parsed_object.bbox.h    = reader.getAttributeInt(XML_OBJECT_HEIGHT);
+
+    target->objects.push_back(parsed_object);
 
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::loadObjectGroupProperties end\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::loadObject end\n");
+    return reader.skipElement() ? OK : ERROR_INVALID_DATA;
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
-string LoadedMap::getAttributeString(XMLElement *element, const string &attribute_name)
+string LoadedMap::getAttributeString(const XmlReader &reader, const char *attribute_name)
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::getAttributeString start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::getAttributeString start\n");
 
-    assert(element);
-    const char *buffer = element->Attribute(attribute_name.c_str());
-
-    if(buffer != NULL)
+    XmlSpan value;
+    if(reader.getAttribute(attribute_name, &value) == true)
     {
-        return string(buffer);
+        return XmlReader::decodeEntities(value);
     }
     else
     {
-        Logger.logMessage(LOG_WARNING, LOG_MAP, "Unable to parse attribute %s",
-                          attribute_name.c_str());
+        LOGMESSAGE(LOG_WARNING, LOG_MAP, "Unable to parse attribute %s\n",
+                          attribute_name);
         return "";
     }
-
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::getAttributeString end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
 
 void LoadedMap::printMapInformation()
 {
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::printMapInformation start\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::printMapInformation start\n");
 
-    Logger.logMessage(LOG_INFO, LOG_MAP, "=== Printing map information... ===\n");
-    Logger.logMessage(LOG_INFO, LOG_MAP, "Map stats follow...\n"
+    LOGMESSAGE(LOG_INFO, LOG_MAP, "=== Printing map information... ===\n");
+    LOGMESSAGE(LOG_INFO, LOG_MAP, "Map stats follow...\n"
                       "Filename: %s\nNumber of tilesets: %d\n"
                       "Number of layers: %d\nNumber of objectgroups: %d\n",
                       m_filename.c_str(), m_tilesets.size(), 
@@ -515,7 +838,7 @@ void LoadedMap::printMapInformation()
 
     for(uint i = 0; i < m_tilesets.size(); i++)
     {
-        Logger.logMessage(LOG_INFO, LOG_MAP, "Tileset information (idx: %d)\n"
+        LOGMESSAGE(LOG_INFO, LOG_MAP, "Tileset information (idx: %d)\n"
                           "Tileset name: %s\n"
                           "Number of tiles: %d\n"
                           "Number of terrains: %u\n",
@@ -527,15 +850,15 @@ void LoadedMap::printMapInformation()
 
     for(uint i = 0; i < m_objectgroups.size(); i++)
     {
-        Logger.logMessage(LOG_INFO, LOG_MAP, "Objectgroup information (idx %d)\n"
+        LOGMESSAGE(LOG_INFO, LOG_MAP, "Objectgroup information (idx %d)\n"
                           "Objectgroup name: %s\n"
                           "Number of properties: %u\n",
                           i,
                           m_objectgroups.at(i).name.c_str(),
                           m_objectgroups.at(i).properties.size());
     }
-    Logger.logMessage(LOG_INFO, LOG_MAP, "=== Printing map information end ===\n");
-    Logger.logMessage(LOG_STATE, LOG_MAP, "LoadedMap::printMapInformation end\n");
+    LOGMESSAGE(LOG_INFO, LOG_MAP, "=== Printing map information end ===\n");
+    LOGMESSAGE(LOG_STATE, LOG_MAP, "LoadedMap::printMapInformation end\n");
 }
 
 ///////////////////////////////////////////////////////////////////////////
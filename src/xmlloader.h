@@ -30,18 +30,19 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <atomic>
 
-#include <tinyxml2.h>
 #include <SDL2/SDL.h>
 
 #include "core.h"
+#include "collisionmap.h"
+#include "layerdecoder.h"
+#include "mappedfile.h"
+#include "xmlreader.h"
 
 using std::string;
 using std::vector;
 using std::map;
-using std::stringstream;
-
-using namespace tinyxml2;
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -79,6 +80,7 @@ struct ImageSource
 struct TileSet
 {
     string      name;
+    uint        firstgid;
     uint        tilewidth;
     uint        tileheight;
     uint        spacing;
@@ -119,7 +121,12 @@ struct Layer
     uint        height;
     string      encoding;
     string      compression;
-    string      data;
+
+    //decoded gids, row by row (width * height entries)
+    vector<uint32_t> gids;
+
+    //points into the mapped file for compiled maps, gids is empty then
+    const uint32_t *mapped_gids;
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -151,9 +158,26 @@ class LoadedMap
         explicit LoadedMap(const string &filename);
         ~LoadedMap();
 
-        //! actually load/parse the file
+        //! actually load/parse the file (TMX or compiled map)
         ErrorCode loadFile();
 
+        //! 0.0 - 1.0, may be read from other threads while loading
+        inline float getLoadProgress() const
+        {
+            return m_load_progress.load();
+        }
+
+        inline const string& getFilename() const
+        {
+            return m_filename;
+        }
+
+        //! directory of the map file, image sources are relative to it
+        string getDirectory() const;
+
+        //! write the loaded map in the compiled format (see binarymap.h)
+        ErrorCode saveBinaryFile(const string &filename) const;
+
         //pass tileset index (0-based)
         inline const string& getImageName(uint tileset) const
         {
@@ -170,6 +194,16 @@ class LoadedMap
             return m_tilesets.at(tileset).spacing;
         }
 
+        uint getTileSetFirstGid(uint tileset) const
+        {
+            if(tileset >= m_tilesets.size())
+            {
+                return 1;
+            }
+
+            return m_tilesets.at(tileset).firstgid;
+        }
+
         int getTileSetMargin(uint tileset) const
         {
             if(tileset > m_tilesets.size())
@@ -190,10 +224,38 @@ class LoadedMap
             return m_tilesets.at(tileset).tiles;
         }
 
-        //get data of a layer (0-based)
-        inline const string& getLayerData(uint layer) const
+        inline uint getLayerCount() const
+        {
+            return m_layers.size();
+        }
+
+        inline const Layer& getLayer(uint layer) const
+        {
+            return m_layers.at(layer);
+        }
+
+        //get decoded gids of a layer (0-based), width * height entries
+        inline const uint32_t* getLayerGids(uint layer) const
+        {
+            const Layer &parsed_layer = m_layers.at(layer);
+            if(parsed_layer.mapped_gids != NULL)
+            {
+                return parsed_layer.mapped_gids;
+            }
+            return parsed_layer.gids.data();
+        }
+
+        //! changes one tile of a layer (0-based), invalidates pointers
+        //! returned by getLayerGids for compiled maps
+        bool setLayerGid(uint layer, uint index, uint32_t gid);
+
+        //! solid quadrants and merged static colliders of a layer (0-based),
+        //! from the terrain corners of its tiles. Terrains with a "collision"
+        //! property other than 0 are solid. Maps without such terrains treat
+        //! every tile as solid. Kept up to date by setLayerGid.
+        inline const CollisionMap& getCollisionMap(uint layer) const
         {
-            return m_layers.at(layer).data;
+            return m_collision_maps.at(layer);
         }
 
         //this contains boxes for events etc
@@ -203,87 +265,102 @@ class LoadedMap
         }
 
     private:
-        void loadMap(XMLElement *element);
-        void loadTileset(XMLElement *element);
-        void loadImageSource(XMLElement *element, TileSet *target);
-        void loadTerrains(XMLElement *element, TileSet *target);
-        void loadTerrainProperties(XMLElement *element, TerrainType *target);
-        void loadTiles(XMLElement *element, TileSet *target);
-        void mapTilesToTerrainPointers(string parsed, TileSet *tset, Tile *target);
-        void loadLayer(XMLElement *element);
-        void loadObjectGroup(XMLElement *element);
-        void loadObjectGroupProperties(XMLElement *element, ObjectGroup *target);
-        void loadObjects(XMLElement *element, ObjectGroup *target);
-
-        string getAttributeString(XMLElement *element, const string &attribute_name);
+        ErrorCode loadXMLFile();
+        ErrorCode loadBinaryFile();
+
+        void loadMap(XmlReader &reader);
+        ErrorCode loadTileset(XmlReader &reader);
+        ErrorCode loadImageSource(XmlReader &reader, TileSet *target);
+        ErrorCode loadTerrains(XmlReader &reader, TileSet *target);
+        ErrorCode loadTerrain(XmlReader &reader, TileSet *target);
+        ErrorCode loadProperties(XmlReader &reader, map<string, string> *target);
+        ErrorCode loadTile(XmlReader &reader, TileSet *target, vector<int> *terrains);
+        void mapTilesToTerrainPointers(const vector<int> &terrains, TileSet *tset);
+        void buildCollisionMaps();
+        uint8_t getCollisionMask(uint32_t gid) const;
+        ErrorCode loadLayer(XmlReader &reader);
+        ErrorCode loadLayerData(XmlReader &reader, Layer *target);
+        ErrorCode loadObjectGroup(XmlReader &reader);
+        ErrorCode loadObject(XmlReader &reader, ObjectGroup *target);
+
+        string getAttributeString(const XmlReader &reader, const char *attribute_name);
 
         void printMapInformation();
 
         string          m_filename;
+        std::atomic<float> m_load_progress;
 
         TileMap         m_map;
         vector<TileSet> m_tilesets;
         vector<Layer>   m_layers;
         vector<ObjectGroup> m_objectgroups;
 
-        XMLDocument     m_doc;
-
-        static const string XML_MAP;
-        static const string XML_MAP_WIDTH;
-        static const string XML_MAP_HEIGHT;
-        static const string XML_MAP_TILEWIDTH;
-        static const string XML_MAP_TILEHEIGHT;
-
-        static const string XML_TILESET;
-        static const string XML_TILESET_NAME;
-        static const string XML_TILESET_WIDTH;
-        static const string XML_TILESET_HEIGHT;
-        static const string XML_TILESET_SPACING;
-        static const string XML_TILESET_MARGIN;
-
-        static const string XML_IMAGE;
-        static const string XML_IMAGE_SOURCE;
-        static const string XML_IMAGE_WIDTH;
-        static const string XML_IMAGE_HEIGHT;
-
-        static const string XML_TERRAINTYPE;
-        static const string XML_TERRAIN;
-        static const string XML_TERRAIN_NAME;
-        static const string XML_TERRAIN_TILE;
-        static const string XML_TERRAIN_PROPS;
-        static const string XML_TERRAIN_PROP;
-        static const string XML_TERRAIN_PROP_NAME;
-        static const string XML_TERRAIN_PROP_VALUE;
-
-        static const string XML_TILE;
-        static const string XML_TILE_ID;
-        static const string XML_TILE_TERRAIN;
-
-        static const string XML_LAYER;
-        static const string XML_LAYER_NAME;
-        static const string XML_LAYER_WIDTH;
-        static const string XML_LAYER_HEIGHT;
-        static const string XML_LAYER_DATA;
-        static const string XML_LAYER_DATA_ENCODING;
-        static const string XML_LAYER_DATA_COMPRESSION;
-
-        static const string XML_OBJECTGROUP;
-        static const string XML_OBJECTGROUP_DRAWORDER;
-        static const string XML_OBJECTGROUP_NAME;
-        static const string XML_OBJECTGROUP_WIDTH;
-        static const string XML_OBJECTGROUP_HEIGHT;
-
-        static const string XML_OBJECTGROUP_PROPS;
-        static const string XML_OBJECTGROUP_PROP;
-        static const string XML_OBJECTGROUP_PROP_NAME;
-        static const string XML_OBJECTGROUP_PROP_VALUE;
-
-        static const string XML_OBJECT;
-        static const string XML_OBJECT_NAME;
-        static const string XML_OBJECT_X;
-        static const string XML_OBJECT_Y;
-        static const string XML_OBJECT_WIDTH;
-        static const string XML_OBJECT_HEIGHT;
+        //one per layer, built once loading is done
+        vector<CollisionMap> m_collision_maps;
+        //gid -> CollisionQuadrant mask, m_default_collision_mask past the end
+        vector<uint8_t> m_tile_collision_masks;
+        uint8_t         m_default_collision_mask;
+
+        //file being parsed, stays mapped as storage of compiled maps
+        MappedFile      m_mapped_file;
+
+        static const char* const XML_MAP;
+        static const char* const XML_MAP_WIDTH;
+        static const char* const XML_MAP_HEIGHT;
+        static const char* const XML_MAP_TILEWIDTH;
+        static const char* const XML_MAP_TILEHEIGHT;
+
+        static const char* const XML_TILESET;
+        static const char* const XML_TILESET_NAME;
+        static const char* const XML_TILESET_FIRSTGID;
+        static const char* const XML_TILESET_WIDTH;
+        static const char* const XML_TILESET_HEIGHT;
+        static const char* const XML_TILESET_SPACING;
+        static const char* const XML_TILESET_MARGIN;
+
+        static const char* const XML_IMAGE;
+        static const char* const XML_IMAGE_SOURCE;
+        static const char* const XML_IMAGE_WIDTH;
+        static const char* const XML_IMAGE_HEIGHT;
+
+        static const char* const XML_TERRAINTYPE;
+        static const char* const XML_TERRAIN;
+        static const char* const XML_TERRAIN_NAME;
+        static const char* const XML_TERRAIN_TILE;
+        static const char* const XML_TERRAIN_PROPS;
+
+        static const char* const XML_TILE;
+        static const char* const XML_TILE_ID;
+        static const char* const XML_TILE_TERRAIN;
+
+        static const char* const XML_LAYER;
+        static const char* const XML_LAYER_NAME;
+        static const char* const XML_LAYER_WIDTH;
+        static const char* const XML_LAYER_HEIGHT;
+        static const char* const XML_LAYER_DATA;
+        static const char* const XML_LAYER_DATA_ENCODING;
+        static const char* const XML_LAYER_DATA_COMPRESSION;
+
+        static const char* const XML_OBJECTGROUP;
+        static const char* const XML_OBJECTGROUP_DRAWORDER;
+        static const char* const XML_OBJECTGROUP_NAME;
+        static const char* const XML_OBJECTGROUP_WIDTH;
+        static const char* const XML_OBJECTGROUP_HEIGHT;
+
+        static const char* const XML_OBJECTGROUP_PROPS;
+
+        static const char* const XML_PROPERTY;
+        static const char* const XML_PROPERTY_NAME;
+        static const char* const XML_PROPERTY_VALUE;
+
+        static const char* const PROPERTY_COLLISION;
+
+        static const char* const XML_OBJECT;
+        static const char* const XML_OBJECT_NAME;
+        static const char* const XML_OBJECT_X;
+        static const char* const XML_OBJECT_Y;
+        static const char* const XML_OBJECT_WIDTH;
+        static const char* const XML_OBJECT_HEIGHT;
 
         DISABLECOPY(LoadedMap);
 };
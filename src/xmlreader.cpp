@@ -0,0 +1,451 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "xmlreader.h"
+
+///////////////////////////////////////////////////////////////////////////
+
+XmlReader::XmlReader(const char *data, size_t size) :
+    m_begin(data),
+    m_pos(data),
+    m_end(data + size),
+    m_pending_end(false),
+    m_depth(0)
+{
+    //skip the UTF-8 byte order mark
+    if(size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    {
+        m_pos += 3;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+XmlReader::Token XmlReader::next()
+{
+    if(m_pending_end == true)
+    {
+        m_pending_end = false;
+        m_attributes.clear();
+        m_depth--;
+        return TOKEN_END_ELEMENT;
+    }
+
+    while(m_pos != m_end)
+    {
+        if(*m_pos == '<')
+        {
+            Token token = parseMarkup();
+            if(token == TOKEN_TEXT && m_text.length == 0)
+            {
+                //comment or processing instruction, nothing to report
+                continue;
+            }
+            return token;
+        }
+
+        const char *text_start = m_pos;
+        const char *text_end = static_cast<const char*>(memchr(m_pos, '<', m_end - m_pos));
+        m_pos = (text_end != NULL) ? text_end : m_end;
+
+        for(const char *c = text_start; c != m_pos; ++c)
+        {
+            if(isWhitespace(*c) == false)
+            {
+                m_text.data = text_start;
+                m_text.length = m_pos - text_start;
+                return TOKEN_TEXT;
+            }
+        }
+    }
+
+    return (m_depth == 0) ? TOKEN_END_OF_DOCUMENT : TOKEN_ERROR;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool XmlReader::skipElement()
+{
+    int depth = 1;
+    while(depth > 0)
+    {
+        switch(next())
+        {
+            case TOKEN_START_ELEMENT:
+                depth++;
+                break;
+            case TOKEN_END_ELEMENT:
+                depth--;
+                break;
+            case TOKEN_TEXT:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+XmlReader::Token XmlReader::parseMarkup()
+{
+    m_text = XmlSpan();
+    size_t left = m_end - m_pos;
+
+    if(left >= 4 && memcmp(m_pos, "<!--", 4) == 0)
+    {
+        return skipPast("-->") ? TOKEN_TEXT : TOKEN_ERROR;
+    }
+    if(left >= 9 && memcmp(m_pos, "<![CDATA[", 9) == 0)
+    {
+        const char *start = m_pos + 9;
+        m_pos = start;
+        if(skipPast("]]>") == false)
+        {
+            return TOKEN_ERROR;
+        }
+        m_text.data = start;
+        m_text.length = (m_pos - 3) - start;
+        return TOKEN_TEXT;
+    }
+    if(left >= 2 && (m_pos[1] == '?' || m_pos[1] == '!'))
+    {
+        return skipPast(">") ? TOKEN_TEXT : TOKEN_ERROR;
+    }
+    if(left >= 2 && m_pos[1] == '/')
+    {
+        return parseEndElement();
+    }
+    return parseStartElement();
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+XmlReader::Token XmlReader::parseStartElement()
+{
+    ++m_pos;
+    m_attributes.clear();
+
+    if(parseName(&m_name) == false)
+    {
+        return TOKEN_ERROR;
+    }
+
+    while(true)
+    {
+        skipWhitespace();
+        if(m_pos == m_end)
+        {
+            return TOKEN_ERROR;
+        }
+
+        if(*m_pos == '>')
+        {
+            ++m_pos;
+            m_depth++;
+            return TOKEN_START_ELEMENT;
+        }
+
+        if(*m_pos == '/')
+        {
+            if(m_end - m_pos < 2 || m_pos[1] != '>')
+            {
+                return TOKEN_ERROR;
+            }
+            m_pos += 2;
+            m_depth++;
+            m_pending_end = true;
+            return TOKEN_START_ELEMENT;
+        }
+
+        Attribute attribute;
+        if(parseName(&attribute.name) == false)
+        {
+            return TOKEN_ERROR;
+        }
+
+        skipWhitespace();
+        if(m_pos == m_end || *m_pos != '=')
+        {
+            return TOKEN_ERROR;
+        }
+        ++m_pos;
+        skipWhitespace();
+
+        if(m_pos == m_end || (*m_pos != '"' && *m_pos != '\''))
+        {
+            return TOKEN_ERROR;
+        }
+
+        char quote = *m_pos++;
+        const char *value_end = static_cast<const char*>(memchr(m_pos, quote, m_end - m_pos));
+        if(value_end == NULL)
+        {
+            return TOKEN_ERROR;
+        }
+
+        attribute.value.data = m_pos;
+        attribute.value.length = value_end - m_pos;
+        m_attributes.push_back(attribute);
+        m_pos = value_end + 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+XmlReader::Token XmlReader::parseEndElement()
+{
+    m_pos += 2;
+    m_attributes.clear();
+
+    if(parseName(&m_name) == false)
+    {
+        return TOKEN_ERROR;
+    }
+
+    skipWhitespace();
+    if(m_pos == m_end || *m_pos != '>' || m_depth == 0)
+    {
+        return TOKEN_ERROR;
+    }
+
+    ++m_pos;
+    m_depth--;
+    return TOKEN_END_ELEMENT;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool XmlReader::skipPast(const char *terminator)
+{
+    size_t length = strlen(terminator);
+    while(m_pos != m_end)
+    {
+        const char *found = static_cast<const char*>(memchr(m_pos, terminator[0], m_end - m_pos));
+        if(found == NULL || static_cast<size_t>(m_end - found) < length)
+        {
+            break;
+        }
+        if(memcmp(found, terminator, length) == 0)
+        {
+            m_pos = found + length;
+            return true;
+        }
+        m_pos = found + 1;
+    }
+
+    m_pos = m_end;
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool XmlReader::parseName(XmlSpan *name)
+{
+    const char *start = m_pos;
+    while(m_pos != m_end && isWhitespace(*m_pos) == false &&
+          *m_pos != '>' && *m_pos != '/' && *m_pos != '=')
+    {
+        ++m_pos;
+    }
+
+    name->data = start;
+    name->length = m_pos - start;
+    return name->length > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void XmlReader::skipWhitespace()
+{
+    while(m_pos != m_end && isWhitespace(*m_pos))
+    {
+        ++m_pos;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool XmlReader::getAttribute(const char *name, XmlSpan *value) const
+{
+    for(uint i = 0; i < m_attributes.size(); i++)
+    {
+        if(m_attributes[i].name.equals(name))
+        {
+            *value = m_attributes[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+string XmlReader::getAttributeString(const char *name) const
+{
+    XmlSpan value;
+    if(getAttribute(name, &value) == false)
+    {
+        return "";
+    }
+    return decodeEntities(value);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+uint XmlReader::getAttributeUInt(const char *name, uint default_value) const
+{
+    XmlSpan value;
+    if(getAttribute(name, &value) == false || value.length == 0 ||
+       value.data[0] < '0' || value.data[0] > '9')
+    {
+        return default_value;
+    }
+
+    uint parsed = 0;
+    for(size_t i = 0; i < value.length && value.data[i] >= '0' && value.data[i] <= '9'; i++)
+    {
+        uint digit = value.data[i] - '0';
+        if(parsed > (UINT_MAX - digit) / 10)
+        {
+            return default_value;
+        }
+        parsed = parsed * 10 + digit;
+    }
+    return parsed;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int XmlReader::getAttributeInt(const char *name, int default_value) const
+{
+    XmlSpan value;
+    if(getAttribute(name, &value) == false || value.length == 0)
+    {
+        return default_value;
+    }
+
+    size_t i = 0;
+    bool negative = false;
+    if(value.data[0] == '-' || value.data[0] == '+')
+    {
+        negative = value.data[0] == '-';
+        i++;
+    }
+
+    if(i == value.length || value.data[i] < '0' || value.data[i] > '9')
+    {
+        return default_value;
+    }
+
+    //INT_MIN itself is not accepted, its magnitude does not fit
+    int parsed = 0;
+    for(; i < value.length && value.data[i] >= '0' && value.data[i] <= '9'; i++)
+    {
+        int digit = value.data[i] - '0';
+        if(parsed > (INT_MAX - digit) / 10)
+        {
+            return default_value;
+        }
+        parsed = parsed * 10 + digit;
+    }
+    return negative ? -parsed : parsed;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+string XmlReader::decodeEntities(const XmlSpan &span)
+{
+    const char *amp = static_cast<const char*>(memchr(span.data, '&', span.length));
+    if(amp == NULL)
+    {
+        return string(span.data, span.length);
+    }
+
+    static const struct { const char *name; char value; } entities[] =
+    {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' },
+        { "&quot;", '"' }, { "&apos;", '\'' }
+    };
+
+    string result;
+    result.reserve(span.length);
+
+    const char *pos = span.data;
+    const char *end = span.data + span.length;
+    while(pos != end)
+    {
+        if(*pos != '&')
+        {
+            result.push_back(*pos++);
+            continue;
+        }
+
+        const char *semicolon = static_cast<const char*>(memchr(pos, ';', end - pos));
+        bool replaced = false;
+
+        if(semicolon != NULL && semicolon - pos > 2 && pos[1] == '#')
+        {
+            //numeric reference, only ASCII is resolved
+            bool hex = pos[2] == 'x';
+            long code = strtol(pos + (hex ? 3 : 2), NULL, hex ? 16 : 10);
+            if(code > 0 && code < 128)
+            {
+                result.push_back(static_cast<char>(code));
+                pos = semicolon + 1;
+                replaced = true;
+            }
+        }
+        else if(semicolon != NULL)
+        {
+            size_t length = semicolon - pos + 1;
+            for(uint i = 0; i < sizeof(entities) / sizeof(entities[0]); i++)
+            {
+                if(strlen(entities[i].name) == length &&
+                   memcmp(pos, entities[i].name, length) == 0)
+                {
+                    result.push_back(entities[i].value);
+                    pos = semicolon + 1;
+                    replaced = true;
+                    break;
+                }
+            }
+        }
+
+        if(replaced == false)
+        {
+            result.push_back(*pos++);
+        }
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////
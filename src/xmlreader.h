@@ -0,0 +1,164 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef XMLREADER_H
+#define XMLREADER_H
+
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! piece of the parsed buffer, nothing is copied or terminated
+struct XmlSpan
+{
+    XmlSpan() :
+        data(NULL),
+        length(0)
+    {
+    }
+
+    inline bool equals(const char *other) const
+    {
+        return strncmp(data, other, length) == 0 && other[length] == '\0';
+    }
+
+    const char  *data;
+    size_t      length;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Streaming (pull) XML tokenizer working in place on a read-only buffer
+//!
+//! Only the subset needed for TMX is handled: elements, attributes, text,
+//! CDATA, comments, processing instructions and doctypes. Empty elements
+//! (<a/>) are reported as a start followed by an end token. No tree is
+//! built, attributes are only valid until the next call of next().
+class XmlReader
+{
+    DISABLECOPY(XmlReader);
+
+    public:
+        enum Token
+        {
+            TOKEN_START_ELEMENT,
+            TOKEN_END_ELEMENT,
+            TOKEN_TEXT,
+            TOKEN_END_OF_DOCUMENT,
+            TOKEN_ERROR
+        };
+
+        XmlReader(const char *data, size_t size);
+
+        //! advances to the next token, whitespace only text is skipped
+        Token next();
+
+        //! skips the children and end of the element just started
+        bool skipElement();
+
+        inline const XmlSpan& getName() const
+        {
+            return m_name;
+        }
+
+        inline const XmlSpan& getText() const
+        {
+            return m_text;
+        }
+
+        //! raw (undecoded) attribute value of the current start element
+        bool getAttribute(const char *name, XmlSpan *value) const;
+
+        inline bool hasAttribute(const char *name) const
+        {
+            XmlSpan value;
+            return getAttribute(name, &value);
+        }
+
+        //! attribute value with entities resolved, "" if missing
+        string getAttributeString(const char *name) const;
+
+        //! leading integer of the attribute (e.g. 12 for "12.5"),
+        //! default_value if it is missing or out of range
+        uint getAttributeUInt(const char *name, uint default_value = 0) const;
+        int getAttributeInt(const char *name, int default_value = 0) const;
+
+        //! bytes consumed so far, for progress reporting
+        inline size_t getOffset() const
+        {
+            return m_pos - m_begin;
+        }
+
+        inline size_t getSize() const
+        {
+            return m_end - m_begin;
+        }
+
+        static string decodeEntities(const XmlSpan &span);
+
+    private:
+        struct Attribute
+        {
+            XmlSpan name;
+            XmlSpan value;
+        };
+
+        Token parseMarkup();
+        Token parseStartElement();
+        Token parseEndElement();
+        bool skipPast(const char *terminator);
+        bool parseName(XmlSpan *name);
+        void skipWhitespace();
+
+        static inline bool isWhitespace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        const char  *m_begin;
+        const char  *m_pos;
+        const char  *m_end;
+
+        XmlSpan     m_name;
+        XmlSpan     m_text;
+        vector<Attribute> m_attributes;
+
+        //<a/> is reported as start + end, the end is still pending
+        bool        m_pending_end;
+        int         m_depth;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,411 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+//
+// storyofanerd_logdecoder: turns a binary log written by Logger::startBinary
+// back into text (see binarylog.h)
+//
+// usage: storyofanerd_logdecoder [--source] <input.blog>
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "binarylog.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+struct DecodedFormat
+{
+    uint        level;
+    uint        category;
+    uint        line;
+    string      file;
+    string      format;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! reads values out of one record, past the end everything reads as 0
+class RecordReader
+{
+    public:
+        RecordReader(const char *data, size_t size) :
+            m_data(data), m_size(size), m_position(0)
+        {
+        }
+
+        inline bool atEnd() const
+        {
+            return m_position >= m_size;
+        }
+
+        template<typename T>
+        T get()
+        {
+            T value = 0;
+            if(m_position + sizeof(T) <= m_size)
+            {
+                memcpy(&value, m_data + m_position, sizeof(T));
+            }
+            m_position += sizeof(T);
+            return value;
+        }
+
+        inline void skipToEnd()
+        {
+            m_position = m_size;
+        }
+
+        string getString()
+        {
+            uint16_t length = get<uint16_t>();
+            if(m_position + length > m_size)
+            {
+                m_position = m_size;
+                return "";
+            }
+
+            string value(m_data + m_position, length);
+            m_position += length;
+            return value;
+        }
+
+    private:
+        const char *m_data;
+        size_t  m_size;
+        size_t  m_position;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! flags, width, precision and length modifiers allowed in a conversion
+static const char SPEC_CHARACTERS[] = "-+ #0123456789.hljztLq";
+
+///////////////////////////////////////////////////////////////////////////
+
+//! formats the next argument with one printf conversion, the length
+//! modifiers of the call site are replaced by the ones of the stored type.
+//! spec only holds SPEC_CHARACTERS, formatMessage checks it
+static void appendArgument(string &out, string spec, char conversion,
+                           RecordReader &arguments)
+{
+    char text[512];
+    text[0] = '\0';
+
+    string::size_type modifier = spec.find_first_of("hljztLq");
+    if(modifier != string::npos)
+    {
+        spec.erase(modifier);
+    }
+
+    if(arguments.atEnd() == true)
+    {
+        out += "<missing>";
+        return;
+    }
+
+    uint8_t tag = arguments.get<uint8_t>();
+    switch(tag)
+    {
+        case BINLOG_ARG_INT32:
+        case BINLOG_ARG_UINT32:
+        {
+            uint32_t value = arguments.get<uint32_t>();
+            if(conversion == 's')
+            {
+                out += "<invalid>";
+                return;
+            }
+            if(strchr("eEfFgGaA", conversion) != NULL)
+            {
+                snprintf(text, sizeof(text), (spec + conversion).c_str(),
+                         tag == BINLOG_ARG_INT32 ? static_cast<double>(static_cast<int32_t>(value)) :
+                                                   static_cast<double>(value));
+            }
+            else
+            {
+                snprintf(text, sizeof(text), (spec + conversion).c_str(), value);
+            }
+            break;
+        }
+        case BINLOG_ARG_INT64:
+        case BINLOG_ARG_UINT64:
+        {
+            unsigned long long value = arguments.get<uint64_t>();
+            if(conversion == 's' || strchr("eEfFgGaA", conversion) != NULL)
+            {
+                out += "<invalid>";
+                return;
+            }
+            snprintf(text, sizeof(text), (spec + "ll" + conversion).c_str(), value);
+            break;
+        }
+        case BINLOG_ARG_DOUBLE:
+        {
+            double value = arguments.get<double>();
+            if(strchr("eEfFgGaA", conversion) == NULL)
+            {
+                conversion = 'g';
+            }
+            snprintf(text, sizeof(text), (spec + conversion).c_str(), value);
+            break;
+        }
+        case BINLOG_ARG_STRING:
+        {
+            string value = arguments.getString();
+            snprintf(text, sizeof(text), (spec + 's').c_str(), value.c_str());
+            break;
+        }
+        case BINLOG_ARG_POINTER:
+        {
+            unsigned long long value = arguments.get<uint64_t>();
+            snprintf(text, sizeof(text), "0x%llx", value);
+            break;
+        }
+        default:
+            //unknown tag, the rest of the record can not be trusted
+            out += "<corrupt>";
+            arguments.skipToEnd();
+            return;
+    }
+
+    out += text;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static string formatMessage(const string &format, RecordReader &arguments)
+{
+    string out;
+
+    for(string::size_type i = 0; i < format.size(); i++)
+    {
+        if(format[i] != '%')
+        {
+            out += format[i];
+            continue;
+        }
+
+        if(i + 1 < format.size() && format[i + 1] == '%')
+        {
+            out += '%';
+            i++;
+            continue;
+        }
+
+        //flags, width, precision and length up to the conversion
+        string spec = "%";
+        for(i++; i < format.size(); i++)
+        {
+            char c = format[i];
+            if(strchr("diouxXeEfFgGaAcsp", c) != NULL)
+            {
+                appendArgument(out, spec, c, arguments);
+                break;
+            }
+
+            //'*' takes its value from the next int argument
+            if(c == '*')
+            {
+                arguments.get<uint8_t>();
+                char number[16];
+                snprintf(number, sizeof(number), "%d", arguments.get<int32_t>());
+                spec += number;
+                continue;
+            }
+
+            //the format comes from the file, anything else (%n!) must not
+            //reach snprintf
+            if(c == '\0' || strchr(SPEC_CHARACTERS, c) == NULL)
+            {
+                out += "<corrupt>";
+                arguments.skipToEnd();
+                if(format[format.size() - 1] == '\n')
+                {
+                    out += '\n';
+                }
+                return out;
+            }
+
+            spec += c;
+        }
+    }
+
+    return out;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    bool print_source = false;
+    const char *filename = NULL;
+
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--source") == 0)
+        {
+            print_source = true;
+        }
+        else
+        {
+            filename = argv[i];
+        }
+    }
+
+    if(filename == NULL)
+    {
+        fprintf(stderr, "usage: %s [--source] <input.blog>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(filename, "rb");
+    if(file == NULL)
+    {
+        fprintf(stderr, "%s: unable to open file\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    BinaryLogHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 ||
+       memcmp(header.magic, BINARYLOG_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != BINARYLOG_VERSION)
+    {
+        fprintf(stderr, "%s: not a binary log of this version\n", filename);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    map<uint32_t, DecodedFormat> formats;
+    vector<char> record;
+
+    uint8_t type;
+    while(fread(&type, 1, 1, file) == 1)
+    {
+        if(type == BINLOG_FORMAT)
+        {
+            //fixed part, then two length prefixed strings
+            char fixed[10];
+            if(fread(fixed, 1, sizeof(fixed), file) != sizeof(fixed))
+            {
+                break;
+            }
+
+            RecordReader reader(fixed, sizeof(fixed));
+            uint32_t id = reader.get<uint32_t>();
+            DecodedFormat &format = formats[id];
+            format.level = reader.get<uint8_t>();
+            format.category = reader.get<uint8_t>();
+            format.line = reader.get<uint32_t>();
+
+            string *strings[2] = { &format.file, &format.format };
+            for(uint i = 0; i < 2; i++)
+            {
+                uint16_t length;
+                if(fread(&length, sizeof(length), 1, file) != 1)
+                {
+                    break;
+                }
+                record.resize(length);
+                if(length > 0 && fread(record.data(), 1, length, file) != length)
+                {
+                    break;
+                }
+                strings[i]->assign(record.data(), length);
+            }
+        }
+        else if(type == BINLOG_MESSAGE)
+        {
+            char fixed[BINARYLOG_MESSAGE_HEADER_SIZE - 1];
+            if(fread(fixed, 1, sizeof(fixed), file) != sizeof(fixed))
+            {
+                break;
+            }
+
+            RecordReader reader(fixed, sizeof(fixed));
+            uint32_t id = reader.get<uint32_t>();
+            uint64_t timestamp = reader.get<uint64_t>();
+            uint16_t argument_bytes = reader.get<uint16_t>();
+
+            record.resize(argument_bytes);
+            if(argument_bytes > 0 && fread(record.data(), 1, argument_bytes, file) != argument_bytes)
+            {
+                break;
+            }
+
+            //back to wall clock time through the reference in the header
+            int64_t realtime = header.realtime_ns +
+                               (static_cast<int64_t>(timestamp) - header.monotonic_ns);
+            time_t seconds = realtime / 1000000000;
+            struct tm timeinfo;
+            localtime_r(&seconds, &timeinfo);
+            char current_time[16];
+            strftime(current_time, sizeof(current_time), "%T", &timeinfo);
+
+            map<uint32_t, DecodedFormat>::const_iterator format = formats.find(id);
+            if(format == formats.end())
+            {
+                printf("%s.%06d <unknown format %u>\n", current_time,
+                       static_cast<int>((realtime % 1000000000) / 1000), id);
+                continue;
+            }
+
+            RecordReader arguments(record.data(), record.size());
+            string text = formatMessage(format->second.format, arguments);
+
+            if(print_source == true)
+            {
+                printf("%s.%06d %s:%u: %s", current_time,
+                       static_cast<int>((realtime % 1000000000) / 1000),
+                       format->second.file.c_str(), format->second.line, text.c_str());
+            }
+            else
+            {
+                printf("%s.%06d %s", current_time,
+                       static_cast<int>((realtime % 1000000000) / 1000), text.c_str());
+            }
+        }
+        else
+        {
+            fprintf(stderr, "%s: corrupt record, stopping\n", filename);
+            break;
+        }
+    }
+
+    fclose(file);
+    return EXIT_SUCCESS;
+}
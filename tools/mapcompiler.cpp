@@ -0,0 +1,65 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+//
+// storyofanerd_mapc: compiles a TMX map into the binary format loaded by
+// LoadedMap without any XML parsing (see binarymap.h)
+//
+// usage: storyofanerd_mapc <input.tmx> <output.cmap>
+//
+
+#include "common.h"
+#include "core.h"
+#include "xmlloader.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: %s <input.tmx> <output.cmap>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    GameCore::instance().logger().setLogLevel(LOG_WARNING);
+    GameCore::instance().logger().addLoggingCategory(LOG_MAP);
+
+    LoadedMap lmap(argv[1]);
+    ErrorCode ret = lmap.loadFile();
+    if(ret != OK)
+    {
+        fprintf(stderr, "%s: %s\n", argv[1], ERRORMSG(ret).c_str());
+        return EXIT_FAILURE;
+    }
+
+    ret = lmap.saveBinaryFile(argv[2]);
+    if(ret != OK)
+    {
+        fprintf(stderr, "%s: %s\n", argv[2], ERRORMSG(ret).c_str());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+//
+// storyofanerd_mapgen: writes synthetic TMX maps of any size for load,
+// render and collision stress tests. The tilesets reuse
+// tmw_desert_spacing.png, so maps written into res/maps load as they are.
+//
+// usage: storyofanerd_mapgen [options] <output.tmx>
+//
+//   --width=<tiles>, --height=<tiles>   map size (default 256x256)
+//   --layers=<count>                    layer 1 is ground, the others are
+//                                       sparse decoration (default 1)
+//   --tilesets=<count>                  copies of the desert tileset, layer n
+//                                       uses tileset n % count (default 1)
+//   --encoding=<csv|base64|zlib|gzip|zstd>  layer data (default csv)
+//   --terrain=<brick>,<cobblestone>,<dirt>  percent of the ground covered
+//                                       by each terrain, the rest is desert
+//                                       (default 5,5,10)
+//   --objects=<count>                   event objects per 1000 tiles
+//                                       (default 1)
+//   --seed=<number>                     same seed, same map (default 1)
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "common.h"
+#include "errorcodes.h"
+#include "mapgenerator.h"
+
+using std::string;
+
+///////////////////////////////////////////////////////////////////////////
+
+static bool parseTerrain(const char *value, GeneratorOptions *options)
+{
+    double total = 0.0;
+    for(uint terrain = TERRAIN_BRICK; terrain < TERRAIN_COUNT; terrain++)
+    {
+        char *end;
+        options->terrain_percent[terrain] = strtod(value, &end);
+        if(end == value || options->terrain_percent[terrain] < 0.0)
+        {
+            return false;
+        }
+        total += options->terrain_percent[terrain];
+
+        bool last = terrain + 1 == TERRAIN_COUNT;
+        if((last == true && *end != '\0') || (last == false && *end != ','))
+        {
+            return false;
+        }
+        value = end + 1;
+    }
+
+    options->terrain_percent[TERRAIN_DESERT] = 100.0 - total;
+    return total <= 100.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+static void printUsage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--width=<tiles>] [--height=<tiles>] [--layers=<count>]\n"
+            "       [--tilesets=<count>] [--encoding=<csv|base64|zlib|gzip|zstd>]\n"
+            "       [--terrain=<brick>,<cobblestone>,<dirt>] [--objects=<per 1000 tiles>]\n"
+            "       [--seed=<number>] <output.tmx>\n", program);
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    GeneratorOptions options;
+
+    string output;
+    bool valid = true;
+    for(int i = 1; i < argc && valid == true; i++)
+    {
+        if(strncmp(argv[i], "--width=", 8) == 0)
+        {
+            options.width = strtoul(argv[i] + 8, NULL, 10);
+        }
+        else if(strncmp(argv[i], "--height=", 9) == 0)
+        {
+            options.height = strtoul(argv[i] + 9, NULL, 10);
+        }
+        else if(strncmp(argv[i], "--layers=", 9) == 0)
+        {
+            options.layers = strtoul(argv[i] + 9, NULL, 10);
+        }
+        else if(strncmp(argv[i], "--tilesets=", 11) == 0)
+        {
+            options.tilesets = strtoul(argv[i] + 11, NULL, 10);
+        }
+        else if(strncmp(argv[i], "--encoding=", 11) == 0)
+        {
+            options.encoding = argv[i] + 11;
+        }
+        else if(strncmp(argv[i], "--terrain=", 10) == 0)
+        {
+            valid = parseTerrain(argv[i] + 10, &options);
+        }
+        else if(strncmp(argv[i], "--objects=", 10) == 0)
+        {
+            options.objects_per_1000_tiles = strtod(argv[i] + 10, NULL);
+        }
+        else if(strncmp(argv[i], "--seed=", 7) == 0)
+        {
+            options.seed = strtoul(argv[i] + 7, NULL, 10);
+        }
+        else if(argv[i][0] != '-' && output == "")
+        {
+            output = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if(valid == false || output == "" ||
+       MapGenerator::isSupportedEncoding(options.encoding) == false ||
+       options.width == 0 || options.height == 0 ||
+       options.layers == 0 || options.tilesets == 0)
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    MapGenerator generator(options);
+    ErrorCode ret = generator.write(output);
+    if(ret != OK)
+    {
+        fprintf(stderr, "%s: %s\n", output.c_str(), ERRORMSG(ret).c_str());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,517 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#include "mapgenerator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+
+static const char* const TERRAIN_NAMES[TERRAIN_COUNT] =
+{
+    "Desert", "Brick", "Cobblestone", "Dirt"
+};
+
+//! representative tile of each terrain
+static const uint TERRAIN_TILES[TERRAIN_COUNT] = {29, 9, 33, 14};
+
+//! tile id -> terrain corners (top left, top right, bottom left,
+//! bottom right) and probability, as defined in testmap.tmx
+struct TileTerrain
+{
+    uint8_t     corners[4];
+    float       probability;
+};
+
+static const TileTerrain TILE_TERRAINS[MapGenerator::TILESET_TILES] =
+{
+    {{0,0,0,1}, 1.0f}, {{0,0,1,1}, 1.0f}, {{0,0,1,0}, 1.0f}, {{3,3,3,0}, 1.0f},
+    {{3,3,0,3}, 1.0f}, {{0,0,0,3}, 1.0f}, {{0,0,3,3}, 1.0f}, {{0,0,3,0}, 1.0f},
+    {{0,1,0,1}, 1.0f}, {{1,1,1,1}, 1.0f}, {{1,0,1,0}, 1.0f}, {{3,0,3,3}, 1.0f},
+    {{0,3,3,3}, 1.0f}, {{0,3,0,3}, 1.0f}, {{3,3,3,3}, 1.0f}, {{3,0,3,0}, 1.0f},
+    {{0,1,0,0}, 1.0f}, {{1,1,0,0}, 1.0f}, {{1,0,0,0}, 1.0f}, {{1,1,1,0}, 1.0f},
+    {{1,1,0,1}, 1.0f}, {{0,3,0,0}, 1.0f}, {{3,3,0,0}, 1.0f}, {{3,0,0,0}, 1.0f},
+    {{0,0,0,2}, 1.0f}, {{0,0,2,2}, 1.0f}, {{0,0,2,0}, 1.0f}, {{1,0,1,1}, 1.0f},
+    {{0,1,1,1}, 1.0f}, {{0,0,0,0}, 1.0f}, {{0,0,0,0}, 0.5f}, {{0,0,0,0}, 0.5f},
+    {{0,2,0,2}, 1.0f}, {{2,2,2,2}, 1.0f}, {{2,0,2,0}, 1.0f}, {{2,2,2,0}, 1.0f},
+    {{2,2,0,2}, 1.0f}, {{0,0,0,0}, 0.5f}, {{0,0,0,0}, 0.5f}, {{0,0,0,0}, 0.5f},
+    {{0,2,0,0}, 1.0f}, {{2,2,0,0}, 1.0f}, {{2,0,0,0}, 1.0f}, {{2,0,2,2}, 1.0f},
+    {{0,2,2,2}, 1.0f}, {{0,0,0,0}, 0.0f}, {{0,0,0,0}, 0.5f}, {{0,0,0,0}, 0.5f}
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+GeneratorOptions::GeneratorOptions() :
+    width(256),
+    height(256),
+    layers(1),
+    tilesets(1),
+    encoding("csv"),
+    objects_per_1000_tiles(1.0),
+    seed(1),
+    image_source("tmw_desert_spacing.png")
+{
+    terrain_percent[TERRAIN_DESERT] = 80.0;
+    terrain_percent[TERRAIN_BRICK] = 5.0;
+    terrain_percent[TERRAIN_COBBLESTONE] = 5.0;
+    terrain_percent[TERRAIN_DIRT] = 10.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+MapGenerator::MapGenerator(const GeneratorOptions &options) :
+    m_options(options),
+    m_random(options.seed)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool MapGenerator::canPlace(uint x, uint y, uint8_t terrain) const
+{
+    //the tileset only has transitions between desert and one other
+    //terrain, so neighbouring corners must be desert or the same terrain
+    uint x0 = x > 0 ? x - 1 : 0;
+    uint y0 = y > 0 ? y - 1 : 0;
+    uint x1 = x < m_options.width ? x + 1 : x;
+    uint y1 = y < m_options.height ? y + 1 : y;
+
+    for(uint ny = y0; ny <= y1; ny++)
+    {
+        for(uint nx = x0; nx <= x1; nx++)
+        {
+            uint8_t neighbour = vertex(nx, ny);
+            if(neighbour != TERRAIN_DESERT && neighbour != terrain)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MapGenerator::generateTerrain()
+{
+    static const uint MIN_RADIUS = 1;
+    static const uint MAX_RADIUS = 8;
+    //patches of dense maps overlap or get rejected, give up eventually
+    static const uint MAX_ATTEMPTS_PER_PATCH = 8;
+
+    uint columns = m_options.width + 1;
+    uint rows = m_options.height + 1;
+    m_vertices.assign(columns * rows, TERRAIN_DESERT);
+
+    uint64_t total = static_cast<uint64_t>(columns) * rows;
+    for(uint terrain = TERRAIN_BRICK; terrain < TERRAIN_COUNT; terrain++)
+    {
+        uint64_t target = total * m_options.terrain_percent[terrain] / 100.0;
+        uint64_t covered = 0;
+
+        //one patch covers about radius^2 * 3 corners
+        uint64_t average_patch = (MIN_RADIUS + MAX_RADIUS) * (MIN_RADIUS + MAX_RADIUS) * 3 / 4;
+        uint64_t attempts = (target / average_patch + 1) * MAX_ATTEMPTS_PER_PATCH;
+
+        for(uint64_t attempt = 0; attempt < attempts && covered < target; attempt++)
+        {
+            uint center_x = random(columns);
+            uint center_y = random(rows);
+            int radius = MIN_RADIUS + random(MAX_RADIUS - MIN_RADIUS + 1);
+
+            for(int dy = -radius; dy <= radius; dy++)
+            {
+                for(int dx = -radius; dx <= radius; dx++)
+                {
+                    int x = center_x + dx;
+                    int y = center_y + dy;
+                    if(x < 0 || y < 0 || x >= static_cast<int>(columns) ||
+                       y >= static_cast<int>(rows) || dx * dx + dy * dy > radius * radius)
+                    {
+                        continue;
+                    }
+
+                    if(vertex(x, y) == TERRAIN_DESERT && canPlace(x, y, terrain) == true)
+                    {
+                        vertex(x, y) = terrain;
+                        covered++;
+                    }
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MapGenerator::createTileLookup()
+{
+    m_tile_lookup.assign(TERRAIN_COUNT * TERRAIN_COUNT * TERRAIN_COUNT * TERRAIN_COUNT,
+                         vector<uint>());
+
+    for(uint key = 0; key < m_tile_lookup.size(); key++)
+    {
+        uint8_t corners[4] = {
+            static_cast<uint8_t>(key & 3), static_cast<uint8_t>((key >> 2) & 3),
+            static_cast<uint8_t>((key >> 4) & 3), static_cast<uint8_t>((key >> 6) & 3)};
+
+        //combinations without a tile (diagonals) take the closest ones
+        int best_matches = -1;
+        for(uint tile = 0; tile < TILESET_TILES; tile++)
+        {
+            if(TILE_TERRAINS[tile].probability <= 0.0f)
+            {
+                continue;
+            }
+
+            int matches = 0;
+            for(uint corner = 0; corner < 4; corner++)
+            {
+                if(TILE_TERRAINS[tile].corners[corner] == corners[corner])
+                {
+                    matches++;
+                }
+            }
+
+            if(matches > best_matches)
+            {
+                best_matches = matches;
+                m_tile_lookup[key].clear();
+            }
+            if(matches == best_matches)
+            {
+                //probability 0.5 tiles are listed once, the others twice
+                m_tile_lookup[key].push_back(tile);
+                if(TILE_TERRAINS[tile].probability >= 1.0f)
+                {
+                    m_tile_lookup[key].push_back(tile);
+                }
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MapGenerator::generateLayer(uint layer, vector<uint32_t> *gids)
+{
+    //decoration layers only cover a few tiles
+    static const uint DECORATION_PERCENT = 10;
+
+    uint32_t firstgid = 1 + (layer % m_options.tilesets) * TILESET_TILES;
+    gids->resize(static_cast<size_t>(m_options.width) * m_options.height);
+
+    for(uint y = 0; y < m_options.height; y++)
+    {
+        for(uint x = 0; x < m_options.width; x++)
+        {
+            uint32_t &gid = (*gids)[static_cast<size_t>(y) * m_options.width + x];
+
+            if(layer > 0)
+            {
+                gid = random(100) < DECORATION_PERCENT ?
+                      firstgid + random(TILESET_TILES) : 0;
+                continue;
+            }
+
+            uint key = vertex(x, y) | (vertex(x + 1, y) << 2) |
+                       (vertex(x, y + 1) << 4) | (vertex(x + 1, y + 1) << 6);
+            const vector<uint> &choices = m_tile_lookup[key];
+            gid = firstgid + choices[random(choices.size())];
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MapGenerator::writeTileset(FILE *file, uint tileset)
+{
+    fprintf(file, " <tileset firstgid=\"%u\" name=\"Desert%u\" tilewidth=\"%u\" "
+            "tileheight=\"%u\" spacing=\"%u\" margin=\"%u\">\n",
+            1 + tileset * TILESET_TILES, tileset, TILE_SIZE, TILE_SIZE,
+            TILESET_SPACING, TILESET_MARGIN);
+    fprintf(file, "  <image source=\"%s\" width=\"%u\" height=\"%u\"/>\n",
+            m_options.image_source.c_str(), TILESET_IMAGE_WIDTH, TILESET_IMAGE_HEIGHT);
+
+    fprintf(file, "  <terraintypes>\n");
+    for(uint terrain = 0; terrain < TERRAIN_COUNT; terrain++)
+    {
+        if(terrain == TERRAIN_BRICK)
+        {
+            fprintf(file, "   <terrain name=\"%s\" tile=\"%u\">\n"
+                    "    <properties>\n"
+                    "     <property name=\"collision\" value=\"1\"/>\n"
+                    "    </properties>\n"
+                    "   </terrain>\n",
+                    TERRAIN_NAMES[terrain], TERRAIN_TILES[terrain]);
+        }
+        else
+        {
+            fprintf(file, "   <terrain name=\"%s\" tile=\"%u\"/>\n",
+                    TERRAIN_NAMES[terrain], TERRAIN_TILES[terrain]);
+        }
+    }
+    fprintf(file, "  </terraintypes>\n");
+
+    for(uint tile = 0; tile < TILESET_TILES; tile++)
+    {
+        const uint8_t *corners = TILE_TERRAINS[tile].corners;
+        fprintf(file, "  <tile id=\"%u\" terrain=\"%u,%u,%u,%u\"", tile,
+                corners[0], corners[1], corners[2], corners[3]);
+        if(TILE_TERRAINS[tile].probability < 1.0f)
+        {
+            fprintf(file, " probability=\"%g\"", TILE_TERRAINS[tile].probability);
+        }
+        fprintf(file, "/>\n");
+    }
+
+    fprintf(file, " </tileset>\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode MapGenerator::encodeLayerData(const vector<uint32_t> &gids, string *out)
+{
+    static const char BASE64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    //gids are stored little endian
+    vector<unsigned char> raw(gids.size() * 4);
+    for(size_t i = 0; i < gids.size(); i++)
+    {
+        raw[i * 4] = gids[i] & 0xff;
+        raw[i * 4 + 1] = (gids[i] >> 8) & 0xff;
+        raw[i * 4 + 2] = (gids[i] >> 16) & 0xff;
+        raw[i * 4 + 3] = (gids[i] >> 24) & 0xff;
+    }
+
+    vector<unsigned char> compressed;
+    const string &encoding = m_options.encoding;
+    if(encoding == "zlib" || encoding == "gzip")
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        //+16 writes a gzip header instead of the zlib one
+        int window_bits = encoding == "gzip" ? 15 + 16 : 15;
+        if(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits,
+                        8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return ERROR_OUT_OF_MEMORY;
+        }
+
+        compressed.resize(deflateBound(&stream, raw.size()));
+        stream.next_in = raw.data();
+        stream.avail_in = raw.size();
+        stream.next_out = compressed.data();
+        stream.avail_out = compressed.size();
+
+        int ret = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        if(ret != Z_STREAM_END)
+        {
+            return ERROR_UNKNOWN;
+        }
+    }
+#ifdef HAVE_ZSTD
+    else if(encoding == "zstd")
+    {
+        compressed.resize(ZSTD_compressBound(raw.size()));
+        size_t size = ZSTD_compress(compressed.data(), compressed.size(),
+                                    raw.data(), raw.size(), ZSTD_CLEVEL_DEFAULT);
+        if(ZSTD_isError(size))
+        {
+            return ERROR_UNKNOWN;
+        }
+        compressed.resize(size);
+    }
+#endif
+    else
+    {
+        compressed.swap(raw);
+    }
+
+    out->clear();
+    out->reserve((compressed.size() + 2) / 3 * 4);
+    for(size_t i = 0; i < compressed.size(); i += 3)
+    {
+        size_t left = compressed.size() - i;
+        uint32_t block = compressed[i] << 16;
+        if(left > 1)
+        {
+            block |= compressed[i + 1] << 8;
+        }
+        if(left > 2)
+        {
+            block |= compressed[i + 2];
+        }
+
+        *out += BASE64[(block >> 18) & 0x3f];
+        *out += BASE64[(block >> 12) & 0x3f];
+        *out += left > 1 ? BASE64[(block >> 6) & 0x3f] : '=';
+        *out += left > 2 ? BASE64[block & 0x3f] : '=';
+    }
+
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode MapGenerator::writeLayer(FILE *file, uint layer)
+{
+    vector<uint32_t> gids;
+    generateLayer(layer, &gids);
+
+    fprintf(file, " <layer name=\"%s %u\" width=\"%u\" height=\"%u\">\n",
+            layer == 0 ? "Ground" : "Decoration", layer + 1,
+            m_options.width, m_options.height);
+
+    if(m_options.encoding == "csv")
+    {
+        fprintf(file, "  <data encoding=\"csv\">\n");
+        for(size_t i = 0; i < gids.size(); i++)
+        {
+            bool row_end = (i + 1) % m_options.width == 0;
+            fprintf(file, "%u%s%s", gids[i], i + 1 < gids.size() ? "," : "",
+                    row_end == true ? "\n" : "");
+        }
+    }
+    else
+    {
+        string data;
+        ErrorCode ret = encodeLayerData(gids, &data);
+        if(ret != OK)
+        {
+            return ret;
+        }
+
+        if(m_options.encoding == "base64")
+        {
+            fprintf(file, "  <data encoding=\"base64\">\n");
+        }
+        else
+        {
+            fprintf(file, "  <data encoding=\"base64\" compression=\"%s\">\n",
+                    m_options.encoding.c_str());
+        }
+        fprintf(file, "   %s\n", data.c_str());
+    }
+
+    fprintf(file, "</data>\n </layer>\n");
+    return OK;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+void MapGenerator::writeObjectGroup(FILE *file)
+{
+    uint map_width = m_options.width * TILE_SIZE;
+    uint map_height = m_options.height * TILE_SIZE;
+
+    fprintf(file, " <objectgroup draworder=\"topdown\" name=\"Object Layer 1\" "
+            "width=\"%u\" height=\"%u\">\n", m_options.width, m_options.height);
+    fprintf(file, "     <properties>\n"
+            "         <property name=\"single\" value=\"true\"/>\n"
+            "     </properties>\n");
+
+    //the player spawns at start, the rest are boxes like in testmap.tmx
+    fprintf(file, "  <object name=\"start\" x=\"1\" y=\"17\" width=\"41\" height=\"40\"/>\n");
+    fprintf(file, "  <object name=\"goal\" x=\"%u\" y=\"1\" width=\"31\" height=\"31\"/>\n",
+            map_width > TILE_SIZE ? map_width - TILE_SIZE : 0);
+
+    uint64_t tiles = static_cast<uint64_t>(m_options.width) * m_options.height;
+    uint64_t count = tiles * m_options.objects_per_1000_tiles / 1000.0;
+    for(uint64_t i = 0; i < count; i++)
+    {
+        uint width = TILE_SIZE / 2 + random(TILE_SIZE * 4);
+        uint height = TILE_SIZE / 2 + random(TILE_SIZE * 2);
+        fprintf(file, "  <object name=\"event\" x=\"%u\" y=\"%u\" width=\"%u\" height=\"%u\"/>\n",
+                random(map_width), random(map_height), width, height);
+    }
+
+    fprintf(file, " </objectgroup>\n");
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+ErrorCode MapGenerator::write(const string &filename)
+{
+    generateTerrain();
+    createTileLookup();
+
+    FILE *file = fopen(filename.c_str(), "w");
+    if(file == NULL)
+    {
+        return ERROR_OPENING_FILE;
+    }
+
+    fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(file, "<map version=\"1.0\" orientation=\"orthogonal\" width=\"%u\" "
+            "height=\"%u\" tilewidth=\"%u\" tileheight=\"%u\">\n",
+            m_options.width, m_options.height, TILE_SIZE, TILE_SIZE);
+
+    for(uint tileset = 0; tileset < m_options.tilesets; tileset++)
+    {
+        writeTileset(file, tileset);
+    }
+
+    ErrorCode ret = OK;
+    for(uint layer = 0; layer < m_options.layers && ret == OK; layer++)
+    {
+        ret = writeLayer(file, layer);
+    }
+
+    writeObjectGroup(file);
+    fprintf(file, "</map>\n");
+
+    if(fclose(file) != 0 && ret == OK)
+    {
+        ret = ERROR_OPENING_FILE;
+    }
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////
+
+bool MapGenerator::isSupportedEncoding(const string &encoding)
+{
+#ifdef HAVE_ZSTD
+    if(encoding == "zstd")
+    {
+        return true;
+    }
+#endif
+    return encoding == "csv" || encoding == "base64" ||
+           encoding == "zlib" || encoding == "gzip";
+}
+
+///////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+/*------------------------------------------------------------------------/
+ *
+ * Copyright (c) 2013 David Robin Cvetko
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the 
+ * "Software"), to deal in the Software without restriction, including 
+ * without limitation the rights to use, copy, modify, merge, publish, 
+ * distribute, sublicense, and/or sell copies of the Software, and to 
+ * permit persons to whom the Software is furnished to do so, subject to 
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *-----------------------------------------------------------------------*/
+
+#ifndef MAPGENERATOR_H
+#define MAPGENERATOR_H
+
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "errorcodes.h"
+
+using std::string;
+using std::vector;
+
+///////////////////////////////////////////////////////////////////////////
+
+//! terrains of tmw_desert_spacing.png, in the order of testmap.tmx
+enum Terrain
+{
+    TERRAIN_DESERT      = 0,
+    TERRAIN_BRICK       = 1,
+    TERRAIN_COBBLESTONE = 2,
+    TERRAIN_DIRT        = 3,
+    TERRAIN_COUNT
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+struct GeneratorOptions
+{
+    //! the defaults of storyofanerd_mapgen
+    GeneratorOptions();
+
+    uint        width;
+    uint        height;
+    //! layer 0 is ground, the others are sparse decoration
+    uint        layers;
+    //! copies of the desert tileset, layer n uses tileset n % tilesets
+    uint        tilesets;
+    //! csv, base64, zlib, gzip or zstd
+    string      encoding;
+    //! percent of ground vertices, index 0 (desert) is the remainder
+    double      terrain_percent[TERRAIN_COUNT];
+    double      objects_per_1000_tiles;
+    uint32_t    seed;
+    //! tileset image, relative to the map. Any image with the layout of
+    //! tmw_desert_spacing.png (see MapGenerator::TILESET_*) works.
+    string      image_source;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+//! Writes synthetic TMX maps: a ground layer of terrain patches with
+//! proper transitions, decoration layers and an object group. The same
+//! options and seed always give the same file.
+class MapGenerator
+{
+    public:
+        explicit MapGenerator(const GeneratorOptions &options);
+
+        ErrorCode write(const string &filename);
+
+        //! zstd is only there when built with HAVE_ZSTD
+        static bool isSupportedEncoding(const string &encoding);
+
+        static const uint TILE_SIZE = 32;
+        //! layout of the tileset image, 8x6 tiles
+        static const uint TILESET_COLUMNS = 8;
+        static const uint TILESET_ROWS = 6;
+        static const uint TILESET_TILES = TILESET_COLUMNS * TILESET_ROWS;
+        static const uint TILESET_SPACING = 1;
+        static const uint TILESET_MARGIN = 1;
+        static const uint TILESET_IMAGE_WIDTH = 265;
+        static const uint TILESET_IMAGE_HEIGHT = 199;
+
+    private:
+        //! patches of terrain on the (width + 1) x (height + 1) tile corners
+        void generateTerrain();
+        bool canPlace(uint x, uint y, uint8_t terrain) const;
+        //! tile choices for every corner combination
+        void createTileLookup();
+        void generateLayer(uint layer, vector<uint32_t> *gids);
+
+        void writeTileset(FILE *file, uint tileset);
+        ErrorCode writeLayer(FILE *file, uint layer);
+        ErrorCode encodeLayerData(const vector<uint32_t> &gids, string *out);
+        void writeObjectGroup(FILE *file);
+
+        inline uint random(uint range)
+        {
+            return m_random() % range;
+        }
+
+        inline uint8_t& vertex(uint x, uint y)
+        {
+            return m_vertices[y * (m_options.width + 1) + x];
+        }
+
+        inline uint8_t vertex(uint x, uint y) const
+        {
+            return m_vertices[y * (m_options.width + 1) + x];
+        }
+
+        GeneratorOptions m_options;
+        std::mt19937 m_random;
+
+        vector<uint8_t> m_vertices;
+        //! 4^4 corner combinations -> candidate tile ids
+        vector<vector<uint> > m_tile_lookup;
+};
+
+///////////////////////////////////////////////////////////////////////////
+
+#endif